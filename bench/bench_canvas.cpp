@@ -0,0 +1,109 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include <QApplication>
+
+#include "view/canvas.hpp"
+
+/**
+ * \brief Document of 4 layers covering 600x200 cells with random characters
+ */
+static void fill(doc::Document& document)
+{
+    std::mt19937 random(0);
+    std::uniform_int_distribution<int> character('!', '~');
+    for ( unsigned color : {0x000000u, 0xff0000u, 0x00aa00u, 0x0000ffu} )
+    {
+        doc::Layer* layer = document.add_layer(color);
+        doc::Layer::EditBatch batch(*layer);
+        for ( int y = 0; y < 200; y++ )
+            for ( int x = 0; x < 600; x++ )
+                if ( random() % 4 == 0 )
+                    layer->set_char(QPoint(x, y), character(random));
+    }
+}
+
+/**
+ * \brief Scrolls a 1920x1080 canvas down by range(0) pixels per frame,
+ * items per second are frames per second
+ */
+static void BM_canvas_scroll(benchmark::State& state)
+{
+    doc::Document document;
+    fill(document);
+    view::Canvas canvas;
+    canvas.set_document(&document);
+    canvas.resize(1920, 1080);
+    canvas.show();
+    canvas.repaint();
+
+    int step = state.range(0);
+    int height = 200 * canvas.cell_size().height();
+    int y = 0;
+    while ( state.KeepRunning() )
+    {
+        y = (y + step) % height;
+        canvas.set_origin(QPoint(0, y));
+        canvas.repaint();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_canvas_scroll)->Arg(1)->Arg(16)->Arg(256)->Arg(1080)->Unit(benchmark::kMillisecond);
+
+/**
+ * \brief Pans diagonally by range(0) pixels per frame
+ */
+static void BM_canvas_pan(benchmark::State& state)
+{
+    doc::Document document;
+    fill(document);
+    view::Canvas canvas;
+    canvas.set_document(&document);
+    canvas.resize(1920, 1080);
+    canvas.show();
+    canvas.repaint();
+
+    int step = state.range(0);
+    QPoint origin;
+    while ( state.KeepRunning() )
+    {
+        origin += QPoint(step, step);
+        if ( origin.y() > 200 * canvas.cell_size().height() )
+            origin = QPoint();
+        canvas.set_origin(origin);
+        canvas.repaint();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_canvas_pan)->Arg(1)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    // Renders without a display
+    if ( qgetenv("QT_QPA_PLATFORM").isEmpty() )
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,290 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "color/batch.hpp"
+#include "color/blend.hpp"
+#include "color/cute_color.hpp"
+#include "color/palette.hpp"
+
+using namespace color;
+
+static std::vector<Color> random_colors()
+{
+    std::mt19937 random(0);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<Color> colors;
+    for ( int i = 0; i < 4096; i++ )
+        colors.emplace_back(channel(random), channel(random), channel(random), channel(random));
+    return colors;
+}
+
+template<class Input, class Function>
+    static void run(benchmark::State& state, const std::vector<Input>& inputs, Function function)
+{
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& input : inputs )
+            benchmark::DoNotOptimize(function(input));
+    }
+    state.SetItemsProcessed(state.iterations() * inputs.size());
+}
+
+template<class Repr>
+    static void BM_to(benchmark::State& state)
+{
+    run(state, random_colors(), [](const Color& color) { return color.to<Repr>(); });
+}
+BENCHMARK_TEMPLATE(BM_to, repr::RGB);
+BENCHMARK_TEMPLATE(BM_to, repr::RGBf);
+BENCHMARK_TEMPLATE(BM_to, repr::HSVf);
+BENCHMARK_TEMPLATE(BM_to, repr::HSV);
+BENCHMARK_TEMPLATE(BM_to, repr::XYZ);
+BENCHMARK_TEMPLATE(BM_to, repr::Lab);
+BENCHMARK_TEMPLATE(BM_to, repr::RGB_int24);
+BENCHMARK_TEMPLATE(BM_to, repr::RGB_int12);
+BENCHMARK_TEMPLATE(BM_to, repr::RGB_int3);
+
+template<class Repr>
+    static void BM_from(benchmark::State& state)
+{
+    std::vector<Repr> values;
+    for ( const auto& color : random_colors() )
+        values.push_back(color.to<Repr>());
+    run(state, values, [](const Repr& value) { return Color(value); });
+}
+BENCHMARK_TEMPLATE(BM_from, repr::RGB);
+BENCHMARK_TEMPLATE(BM_from, repr::RGBf);
+BENCHMARK_TEMPLATE(BM_from, repr::HSVf);
+BENCHMARK_TEMPLATE(BM_from, repr::HSV);
+BENCHMARK_TEMPLATE(BM_from, repr::XYZ);
+BENCHMARK_TEMPLATE(BM_from, repr::Lab);
+BENCHMARK_TEMPLATE(BM_from, repr::RGB_int24);
+BENCHMARK_TEMPLATE(BM_from, repr::RGB_int12);
+BENCHMARK_TEMPLATE(BM_from, repr::RGB_int3);
+
+static void BM_rotate_hue(benchmark::State& state)
+{
+    auto colors = random_colors();
+    std::vector<Color> output(colors.size());
+    uint16_t turn = 0;
+    while ( state.KeepRunning() )
+    {
+        rotate_hue(colors.data(), colors.data() + colors.size(), output.data(), turn += 997);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_rotate_hue);
+
+static void BM_distance(benchmark::State& state)
+{
+    auto colors = random_colors();
+    std::vector<std::pair<Color, Color>> pairs;
+    for ( std::size_t i = 1; i < colors.size(); i++ )
+        pairs.emplace_back(colors[i - 1], colors[i]);
+    run(state, pairs, [](const std::pair<Color, Color>& pair) {
+        return pair.first.distance(pair.second);
+    });
+}
+BENCHMARK(BM_distance);
+
+static void BM_delta_e(benchmark::State& state)
+{
+    DeltaE metric = DeltaE(state.range(0));
+    auto colors = random_colors();
+    std::vector<std::pair<repr::Lab, repr::Lab>> pairs;
+    for ( std::size_t i = 1; i < colors.size(); i++ )
+        pairs.emplace_back(colors[i - 1].to<repr::Lab>(), colors[i].to<repr::Lab>());
+    run(state, pairs, [metric](const std::pair<repr::Lab, repr::Lab>& pair) {
+        return delta_e_squared(pair.first, pair.second, metric);
+    });
+}
+BENCHMARK(BM_delta_e)
+    ->Arg(int(DeltaE::CIE76))
+    ->Arg(int(DeltaE::CIE94))
+    ->Arg(int(DeltaE::CIEDE2000));
+
+/**
+ * \brief Uncached nearest color searches in the xterm-256 palette
+ */
+static void BM_palette_nearest(benchmark::State& state)
+{
+    Palette palette(xterm256_palette(), 16, DeltaE(state.range(0)));
+    std::vector<repr::Lab> queries;
+    for ( const auto& color : random_colors() )
+        queries.push_back(color.to<repr::Lab>());
+    run(state, queries, [&palette](const repr::Lab& lab) { return palette.nearest(lab); });
+}
+BENCHMARK(BM_palette_nearest)
+    ->Arg(int(DeltaE::CIE76))
+    ->Arg(int(DeltaE::CIE94))
+    ->Arg(int(DeltaE::CIEDE2000));
+
+template<class Repr>
+    static void BM_blend(benchmark::State& state)
+{
+    auto colors = random_colors();
+    std::vector<std::pair<Color, Color>> pairs;
+    for ( std::size_t i = 1; i < colors.size(); i++ )
+        pairs.emplace_back(colors[i - 1], colors[i]);
+    run(state, pairs, [](const std::pair<Color, Color>& pair) {
+        return pair.first.blend<Repr>(pair.second, 0.25);
+    });
+}
+BENCHMARK_TEMPLATE(BM_blend, repr::RGBf);
+BENCHMARK_TEMPLATE(BM_blend, repr::HSVf);
+BENCHMARK_TEMPLATE(BM_blend, repr::XYZ);
+BENCHMARK_TEMPLATE(BM_blend, repr::Lab);
+
+/**
+ * \brief Benchmarks a span function on a 1920x1080 frame
+ */
+template<class Function>
+    static void run_span(benchmark::State& state, Function function)
+{
+    auto colors = random_colors();
+    std::vector<PackedColor> a, b;
+    for ( std::size_t i = 0; i < 1920 * 1080; i++ )
+    {
+        a.push_back(colors[i % colors.size()].to<PackedColor>());
+        b.push_back(colors[(i * 7) % colors.size()].to<PackedColor>());
+    }
+    std::vector<PackedColor> output(a.size());
+    while ( state.KeepRunning() )
+    {
+        function(a.data(), b.data(), output.data(), a.size());
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * a.size());
+}
+
+static void BM_blend_span_rgb(benchmark::State& state)
+{
+    run_span(state, [](const PackedColor* a, const PackedColor* b, PackedColor* out, std::size_t n) {
+        blend::rgb(a, b, out, n, 0.25);
+    });
+}
+BENCHMARK(BM_blend_span_rgb)->Unit(benchmark::kMillisecond);
+
+static void BM_blend_span_linear(benchmark::State& state)
+{
+    run_span(state, [](const PackedColor* a, const PackedColor* b, PackedColor* out, std::size_t n) {
+        blend::linear(a, b, out, n, 0.25);
+    });
+}
+BENCHMARK(BM_blend_span_linear)->Unit(benchmark::kMillisecond);
+
+static void BM_blend_span_lab(benchmark::State& state)
+{
+    run_span(state, [](const PackedColor* a, const PackedColor* b, PackedColor* out, std::size_t n) {
+        blend::lab(a, b, out, n, 0.25);
+    });
+}
+BENCHMARK(BM_blend_span_lab)->Unit(benchmark::kMillisecond);
+
+static void BM_over_span(benchmark::State& state)
+{
+    run_span(state, [](const PackedColor* a, const PackedColor*, PackedColor* out, std::size_t n) {
+        blend::over(a, out, n);
+    });
+}
+BENCHMARK(BM_over_span)->Unit(benchmark::kMillisecond);
+
+/**
+ * \brief Benchmarks from_qt on colors of the given spec
+ */
+static void BM_from_qt(benchmark::State& state)
+{
+    std::vector<QColor> colors;
+    for ( const auto& color : random_colors() )
+    {
+        QColor qcolor = to_qt(color);
+        colors.push_back(qcolor.convertTo(QColor::Spec(state.range(0))));
+    }
+    run(state, colors, [](const QColor& color) { return from_qt(color); });
+}
+BENCHMARK(BM_from_qt)->Arg(QColor::Rgb)->Arg(QColor::Hsv)->Arg(QColor::Hsl);
+
+static void BM_to_qrgb(benchmark::State& state)
+{
+    run(state, random_colors(), [](const Color& color) { return to_qrgb(color); });
+}
+BENCHMARK(BM_to_qrgb);
+
+/**
+ * \brief 20 megapixel image in the format range(0)
+ */
+static QImage large_image(const benchmark::State& state)
+{
+    QImage image(5000, 4000, QImage::Format_ARGB32);
+    auto colors = random_colors();
+    for ( int y = 0; y < image.height(); y++ )
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for ( int x = 0; x < image.width(); x++ )
+            line[x] = to_qrgb(colors[(y * image.width() + x) % colors.size()]);
+    }
+    return image.convertToFormat(QImage::Format(state.range(0)));
+}
+
+static void BM_from_qimage(benchmark::State& state)
+{
+    QImage image = large_image(state);
+    while ( state.KeepRunning() )
+        benchmark::DoNotOptimize(from_qimage(image).data());
+    state.SetItemsProcessed(state.iterations() * image.width() * image.height());
+}
+BENCHMARK(BM_from_qimage)
+    ->Arg(QImage::Format_ARGB32)->Arg(QImage::Format_RGB888)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_from_qimage_packed(benchmark::State& state)
+{
+    QImage image = large_image(state);
+    while ( state.KeepRunning() )
+        benchmark::DoNotOptimize(from_qimage_packed(image).data());
+    state.SetItemsProcessed(state.iterations() * image.width() * image.height());
+}
+BENCHMARK(BM_from_qimage_packed)
+    ->Arg(QImage::Format_ARGB32)->Arg(QImage::Format_RGB888)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_to_qimage(benchmark::State& state)
+{
+    QImage image = large_image(state);
+    auto colors = from_qimage(image);
+    while ( state.KeepRunning() )
+    {
+        for ( int y = 0; y < image.height(); y++ )
+            to_qimage_row(colors.data() + y * image.width(), image, y);
+        benchmark::DoNotOptimize(image.constScanLine(0));
+    }
+    state.SetItemsProcessed(state.iterations() * image.width() * image.height());
+}
+BENCHMARK(BM_to_qimage)
+    ->Arg(QImage::Format_ARGB32)->Arg(QImage::Format_RGB888)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,114 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ascii/glyph_atlas.hpp"
+
+using namespace ascii;
+
+/**
+ * \brief Synthetic atlas the size of the printable ASCII range,
+ * rendering needs a running QGuiApplication
+ */
+static GlyphAtlas make_atlas()
+{
+    std::mt19937 random(0);
+    std::uniform_int_distribution<int> ink(0, 255);
+    std::vector<GlyphAtlas::Glyph> glyphs(95);
+    for ( std::size_t i = 0; i < glyphs.size(); i++ )
+    {
+        glyphs[i].character = ' ' + i;
+        int threshold = ink(random);
+        for ( auto& pixel : glyphs[i].pixels )
+            pixel = ink(random) < threshold ? 0 : 255;
+    }
+    return GlyphAtlas(glyphs);
+}
+
+/**
+ * \brief Image-like cells: smooth gradients with some noise
+ */
+static std::vector<GlyphAtlas::Block> make_cells()
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> base(0, 255);
+    std::uniform_int_distribution<int> noise(-20, 20);
+    std::vector<GlyphAtlas::Block> cells(1024);
+    for ( auto& cell : cells )
+    {
+        int from = base(random);
+        int to = base(random);
+        for ( int i = 0; i < GlyphAtlas::block_size; i++ )
+        {
+            int value = from + (to - from) * i / GlyphAtlas::block_size + noise(random);
+            cell[i] = std::max(0, std::min(255, value));
+        }
+    }
+    return cells;
+}
+
+template<class Function>
+    static void run(benchmark::State& state, Function function)
+{
+    auto atlas = make_atlas();
+    auto cells = make_cells();
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& cell : cells )
+            benchmark::DoNotOptimize(function(atlas, cell.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * cells.size());
+    state.counters["ns_per_cell"] = benchmark::Counter(
+        state.iterations() * cells.size(),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert
+    );
+}
+
+static void BM_glyph_match_exhaustive(benchmark::State& state)
+{
+    run(state, [](const GlyphAtlas& atlas, const uint8_t* cell) {
+        std::size_t best = 0;
+        unsigned best_sad = GlyphAtlas::sad(cell, atlas.pixels(0));
+        for ( std::size_t i = 1; i < atlas.size(); i++ )
+        {
+            unsigned sad = GlyphAtlas::sad(cell, atlas.pixels(i));
+            if ( sad < best_sad )
+            {
+                best = i;
+                best_sad = sad;
+            }
+        }
+        return atlas.character(best);
+    });
+}
+BENCHMARK(BM_glyph_match_exhaustive);
+
+static void BM_glyph_match(benchmark::State& state)
+{
+    run(state, [](const GlyphAtlas& atlas, const uint8_t* cell) {
+        return atlas.match(cell);
+    });
+}
+BENCHMARK(BM_glyph_match);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,134 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "document/layer.hpp"
+
+using namespace doc;
+
+/**
+ * \brief Positions of range(0) cells, filling a square when range(1) is 1,
+ * scattered at random over an area 8 times larger when it's 0
+ */
+static std::vector<QPoint> positions(const benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    bool dense = state.range(1);
+    std::vector<QPoint> points;
+    points.reserve(count);
+
+    if ( dense )
+    {
+        int side = std::ceil(std::sqrt(double(count)));
+        for ( std::size_t i = 0; i < count; i++ )
+            points.emplace_back(i % side, i / side);
+    }
+    else
+    {
+        int side = std::ceil(std::sqrt(double(count) * 8));
+        std::mt19937 random(0);
+        std::uniform_int_distribution<int> coord(0, side - 1);
+        for ( std::size_t i = 0; i < count; i++ )
+            points.emplace_back(coord(random), coord(random));
+    }
+
+    return points;
+}
+
+static void fill(Layer& layer, const std::vector<QPoint>& points)
+{
+    for ( std::size_t i = 0; i < points.size(); i++ )
+        layer.set_char(points[i], 'a' + i % 26);
+}
+
+/**
+ * \brief Cell counts (1K, 1M, 10M) with dense and sparse patterns
+ */
+static void sizes(benchmark::internal::Benchmark* bench)
+{
+    for ( int count : {1000, 1000000, 10000000} )
+        for ( int dense : {1, 0} )
+            bench->Args({count, dense});
+    bench->ArgNames({"cells", "dense"});
+    bench->Unit(benchmark::kMillisecond);
+}
+
+static void BM_layer_set_char(benchmark::State& state)
+{
+    auto points = positions(state);
+    while ( state.KeepRunning() )
+    {
+        Layer layer(0);
+        fill(layer, points);
+        benchmark::DoNotOptimize(layer.characters().size());
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_layer_set_char)->Apply(sizes);
+
+static void BM_layer_char_at(benchmark::State& state)
+{
+    auto points = positions(state);
+    Layer layer(0);
+    fill(layer, points);
+    while ( state.KeepRunning() )
+    {
+        for ( QPoint point : points )
+            benchmark::DoNotOptimize(layer.char_at(point));
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_layer_char_at)->Apply(sizes);
+
+static void BM_layer_to_string(benchmark::State& state)
+{
+    auto points = positions(state);
+    Layer layer(0);
+    fill(layer, points);
+    std::size_t bytes = 0;
+    while ( state.KeepRunning() )
+    {
+        std::string text = layer.to_string();
+        bytes += text.size();
+        benchmark::DoNotOptimize(text.data());
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_layer_to_string)->Apply(sizes);
+
+static void BM_layer_fill_rect(benchmark::State& state)
+{
+    int side = std::ceil(std::sqrt(double(state.range(0))));
+    while ( state.KeepRunning() )
+    {
+        Layer layer(0);
+        layer.fill_rect(QRect(0, 0, side, side), '#');
+        benchmark::DoNotOptimize(layer.characters().size());
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+BENCHMARK(BM_layer_fill_rect)->Arg(1000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
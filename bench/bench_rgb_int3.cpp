@@ -0,0 +1,71 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "color/rgb_int3_table.hpp"
+
+using namespace color;
+
+static std::vector<Color> random_colors()
+{
+    std::mt19937 random(0);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<Color> colors;
+    for ( int i = 0; i < 4096; i++ )
+        colors.emplace_back(channel(random), channel(random), channel(random));
+    return colors;
+}
+
+template<class Function>
+    static void run(benchmark::State& state, Function function)
+{
+    auto colors = random_colors();
+    while ( state.KeepRunning() )
+    {
+        for ( const auto& color : colors )
+            benchmark::DoNotOptimize(function(color));
+    }
+    state.SetItemsProcessed(state.iterations() * colors.size());
+}
+
+static void BM_rgb_int3_branches(benchmark::State& state)
+{
+    run(state, [](const Color& color) { return color.to<repr::RGB_int3>(); });
+}
+BENCHMARK(BM_rgb_int3_branches);
+
+static void BM_rgb_int3_table12(benchmark::State& state)
+{
+    run(state, [](const Color& color) { return rgb_int3_lookup(color); });
+}
+BENCHMARK(BM_rgb_int3_table12);
+
+static void BM_rgb_int3_table24(benchmark::State& state)
+{
+    // Build the table outside the timed loop
+    rgb_int3_lookup_exact(Color(0, 0, 0));
+    run(state, [](const Color& color) { return rgb_int3_lookup_exact(color); });
+}
+BENCHMARK(BM_rgb_int3_table24);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,213 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "glyph_atlas.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
+
+namespace ascii {
+
+constexpr int GlyphAtlas::block_width;
+constexpr int GlyphAtlas::block_height;
+constexpr int GlyphAtlas::block_size;
+
+/**
+ * \brief Sum of all the values in a block
+ */
+static unsigned block_sum(const uint8_t* block)
+{
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i total = zero;
+    for ( int i = 0; i < GlyphAtlas::block_size; i += 16 )
+    {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        total = _mm_add_epi64(total, _mm_sad_epu8(values, zero));
+    }
+    return _mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total));
+#else
+    return std::accumulate(block, block + GlyphAtlas::block_size, 0u);
+#endif
+}
+
+unsigned GlyphAtlas::sad(const uint8_t* a, const uint8_t* b)
+{
+#ifdef __SSE2__
+    // Each 64 bit lane sums at most 64 differences, so it can't overflow
+    __m128i total = _mm_setzero_si128();
+    for ( int i = 0; i < block_size; i += 16 )
+    {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        total = _mm_add_epi64(total, _mm_sad_epu8(va, vb));
+    }
+    return _mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total));
+#else
+    unsigned total = 0;
+    for ( int i = 0; i < block_size; i++ )
+        total += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return total;
+#endif
+}
+
+void GlyphAtlas::downsample(const uint8_t* pixels, int width, int height,
+                            int stride, uint8_t* block)
+{
+    for ( int by = 0; by < block_height; by++ )
+    {
+        int top = by * height / block_height;
+        int bottom = std::max(top + 1, (by + 1) * height / block_height);
+        for ( int bx = 0; bx < block_width; bx++ )
+        {
+            int left = bx * width / block_width;
+            int right = std::max(left + 1, (bx + 1) * width / block_width);
+
+            unsigned total = 0;
+            for ( int y = top; y < bottom; y++ )
+                for ( int x = left; x < right; x++ )
+                    total += pixels[y * stride + x];
+
+            unsigned area = (bottom - top) * (right - left);
+            block[by * block_width + bx] = (total + area / 2) / area;
+        }
+    }
+}
+
+GlyphAtlas::GlyphAtlas(const std::vector<Glyph>& glyphs)
+{
+    std::vector<unsigned> sums;
+    sums.reserve(glyphs.size());
+    for ( const auto& glyph : glyphs )
+        sums.push_back(block_sum(glyph.pixels.data()));
+
+    _order.resize(glyphs.size());
+    std::iota(_order.begin(), _order.end(), 0);
+    std::stable_sort(_order.begin(), _order.end(), [&sums](std::size_t a, std::size_t b) {
+        return sums[a] < sums[b];
+    });
+
+    _pixels.reserve(glyphs.size() * block_size);
+    _sums.reserve(glyphs.size());
+    _characters.reserve(glyphs.size());
+    for ( std::size_t index : _order )
+    {
+        _pixels.insert(_pixels.end(), glyphs[index].pixels.begin(), glyphs[index].pixels.end());
+        _sums.push_back(sums[index]);
+        _characters.push_back(glyphs[index].character);
+    }
+}
+
+GlyphAtlas GlyphAtlas::render(const QFont& font)
+{
+    QFontMetrics metrics(font);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    int width = std::max(1, metrics.horizontalAdvance('M'));
+#else
+    int width = std::max(1, metrics.width('M'));
+#endif
+    int height = std::max(1, metrics.height());
+    QImage image(width, height, QImage::Format_RGB32);
+    std::vector<uint8_t> luma(width * height);
+
+    std::vector<Glyph> glyphs;
+    for ( char ch = ' '; ch < 0x7f; ch++ )
+    {
+        if ( ch != ' ' && !metrics.inFont(QChar(ch)) )
+            continue;
+
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setFont(font);
+        painter.setPen(Qt::black);
+        painter.drawText(0, metrics.ascent(), QString(QChar(ch)));
+        painter.end();
+
+        for ( int y = 0; y < height; y++ )
+        {
+            const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for ( int x = 0; x < width; x++ )
+                luma[y * width + x] = qGray(line[x]);
+        }
+
+        Glyph glyph;
+        glyph.character = ch;
+        downsample(luma.data(), width, height, width, glyph.pixels.data());
+        glyphs.push_back(glyph);
+    }
+
+    return GlyphAtlas(glyphs);
+}
+
+std::size_t GlyphAtlas::match_index(const uint8_t* block) const
+{
+    unsigned sum = block_sum(block);
+
+    // Walks outwards from the glyphs with the closest intensity,
+    // |sum - _sums[i]| <= sad(block, pixels(i))
+    std::size_t high = std::lower_bound(_sums.begin(), _sums.end(), sum) - _sums.begin();
+    std::size_t low = high;
+    std::size_t best = high < size() ? high : high - 1;
+    unsigned best_sad = std::numeric_limits<unsigned>::max();
+    const unsigned none = std::numeric_limits<unsigned>::max();
+
+    while ( true )
+    {
+        unsigned low_bound = low > 0 ? sum - _sums[low - 1] : none;
+        unsigned high_bound = high < size() ? _sums[high] - sum : none;
+
+        std::size_t candidate;
+        if ( low_bound <= high_bound )
+        {
+            // Ties can still win if they come first in the input
+            if ( low_bound == none || low_bound > best_sad )
+                break;
+            candidate = --low;
+        }
+        else
+        {
+            if ( high_bound > best_sad )
+                break;
+            candidate = high++;
+        }
+
+        unsigned distance = sad(block, pixels(candidate));
+        if ( distance < best_sad || (distance == best_sad && _order[candidate] < _order[best]) )
+        {
+            best_sad = distance;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+} // namespace ascii
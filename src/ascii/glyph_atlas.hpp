@@ -0,0 +1,132 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_ASCII_GLYPH_ATLAS_HPP
+#define ASCEDIT_ASCII_GLYPH_ATLAS_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <QFont>
+
+namespace ascii {
+
+/**
+ * \brief Bitmaps of the printable characters of a font, for matching
+ * against image cells
+ *
+ * Every glyph is stored as a block of block_width * block_height luminance
+ * values, with dark ink on a white background. Glyphs are sorted by their
+ * total intensity: the difference between the intensity of a glyph and
+ * that of a block is a lower bound of their sum of absolute differences,
+ * so the search can start from the glyphs closest in intensity and stop
+ * as soon as the bound exceeds the best match.
+ */
+class GlyphAtlas
+{
+public:
+    static constexpr int block_width = 8;
+    static constexpr int block_height = 16;
+    static constexpr int block_size = block_width * block_height;
+
+    typedef std::array<uint8_t, block_size> Block;
+
+    struct Glyph
+    {
+        char character;
+        Block pixels;
+    };
+
+    /**
+     * \brief Builds the atlas from pre-rendered glyphs
+     *
+     * When two glyphs match a block equally well, the one coming first
+     * in \p glyphs is chosen.
+     */
+    explicit GlyphAtlas(const std::vector<Glyph>& glyphs);
+
+    /**
+     * \brief Renders all the characters accepted by doc::Layer::set_char
+     * and the space, using \p font
+     */
+    static GlyphAtlas render(const QFont& font);
+
+    /**
+     * \brief Averages a \p width x \p height area of 8-bit \p pixels
+     * down to a block
+     */
+    static void downsample(const uint8_t* pixels, int width, int height,
+                           int stride, uint8_t* block);
+
+    /**
+     * \brief Sum of absolute differences between two blocks
+     */
+    static unsigned sad(const uint8_t* a, const uint8_t* b);
+
+    std::size_t size() const
+    {
+        return _characters.size();
+    }
+
+    bool empty() const
+    {
+        return _characters.empty();
+    }
+
+    /**
+     * \brief Character of the glyph at \p index, glyphs are sorted by intensity
+     */
+    char character(std::size_t index) const
+    {
+        return _characters[index];
+    }
+
+    const uint8_t* pixels(std::size_t index) const
+    {
+        return _pixels.data() + index * block_size;
+    }
+
+    /**
+     * \brief Index of the glyph with the lowest sum of absolute differences
+     * from \p block
+     * \pre !empty()
+     */
+    std::size_t match_index(const uint8_t* block) const;
+
+    /**
+     * \brief Character best matching \p block
+     * \pre !empty()
+     */
+    char match(const uint8_t* block) const
+    {
+        return _characters[match_index(block)];
+    }
+
+private:
+    std::vector<uint8_t>    _pixels;
+    std::vector<unsigned>   _sums;
+    std::vector<char>       _characters;
+    /// Position of each glyph in the input, to break ties
+    std::vector<std::size_t> _order;
+};
+
+} // namespace ascii
+#endif // ASCEDIT_ASCII_GLYPH_ATLAS_HPP
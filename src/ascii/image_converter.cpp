@@ -0,0 +1,183 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "image_converter.hpp"
+
+#include <algorithm>
+
+namespace ascii {
+
+constexpr int ImageConverter::tile_cells;
+
+ImageConverter::ImageConverter(QSize cell_size, ThreadPool& pool)
+    : _cell_size(cell_size), _pool(pool)
+{
+}
+
+QSize ImageConverter::grid_size(const QImage& image) const
+{
+    if ( image.isNull() || _cell_size.width() <= 0 || _cell_size.height() <= 0 )
+        return QSize(0, 0);
+
+    return QSize(
+        (image.width() + _cell_size.width() - 1) / _cell_size.width(),
+        (image.height() + _cell_size.height() - 1) / _cell_size.height()
+    );
+}
+
+ImageConverter::Source ImageConverter::prepare(const QImage& image) const
+{
+    switch ( image.format() )
+    {
+        case QImage::Format_Grayscale8:
+            return {image, true};
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+            return {image, false};
+        default:
+            return {image.convertToFormat(QImage::Format_ARGB32), false};
+    }
+}
+
+void ImageConverter::luminance(const Source& source, QRect cell, uint8_t* output) const
+{
+    for ( int y = cell.top(); y <= cell.bottom(); y++ )
+    {
+        const uchar* line = source.image.constScanLine(y);
+        if ( source.gray )
+        {
+            output = std::copy(line + cell.left(), line + cell.right() + 1, output);
+            continue;
+        }
+
+        const QRgb* pixels = reinterpret_cast<const QRgb*>(line);
+        bool alpha = source.image.format() == QImage::Format_ARGB32;
+        for ( int x = cell.left(); x <= cell.right(); x++ )
+        {
+            QRgb pixel = pixels[x];
+            int luma = (qRed(pixel) * 77 + qGreen(pixel) * 150 + qBlue(pixel) * 29) >> 8;
+            if ( alpha )
+                luma = (luma * qAlpha(pixel) + 255 * (255 - qAlpha(pixel))) / 255;
+            *output++ = luma;
+        }
+    }
+}
+
+CellFeatures ImageConverter::features(const uint8_t* luminance, int area) const
+{
+    int total = 0;
+    int ink = 0;
+    for ( int i = 0; i < area; i++ )
+    {
+        total += luminance[i];
+        if ( (luminance[i] < 128) != _inverted )
+            ink++;
+    }
+
+    CellFeatures result;
+    result.luminance = total / (255.f * area);
+    result.coverage = float(ink) / area;
+    return result;
+}
+
+char ImageConverter::match(const CellFeatures& features) const
+{
+    float tone = _inverted ? features.luminance : 1 - features.luminance;
+    float ink = tone + (features.coverage - tone) * _coverage_weight;
+    int index = ink * _ramp.size();
+    return _ramp[std::min<int>(index, _ramp.size() - 1)];
+}
+
+char ImageConverter::convert_cell(const Source& source, QRect cell,
+                                  std::vector<uint8_t>& buffer) const
+{
+    int area = cell.width() * cell.height();
+    buffer.resize(area);
+    luminance(source, cell, buffer.data());
+
+    if ( !_atlas || _atlas->empty() )
+        return match(features(buffer.data(), area));
+
+    // Glyphs are dark on white
+    if ( _inverted )
+        for ( auto& value : buffer )
+            value = 255 - value;
+
+    GlyphAtlas::Block block;
+    GlyphAtlas::downsample(buffer.data(), cell.width(), cell.height(),
+                           cell.width(), block.data());
+    return _atlas->match(block.data());
+}
+
+void ImageConverter::convert_tile(const Source& source, QSize grid, int tile,
+                                  std::vector<char>& output) const
+{
+    int tiles_per_row = (grid.width() + tile_cells - 1) / tile_cells;
+    int first_column = tile % tiles_per_row * tile_cells;
+    int first_row = tile / tiles_per_row * tile_cells;
+    int last_column = std::min(first_column + tile_cells, grid.width());
+    int last_row = std::min(first_row + tile_cells, grid.height());
+    QRect bounds(0, 0, source.image.width(), source.image.height());
+    std::vector<uint8_t> buffer;
+
+    for ( int row = first_row; row < last_row; row++ )
+    {
+        for ( int column = first_column; column < last_column; column++ )
+        {
+            QRect cell = QRect(
+                QPoint(column * _cell_size.width(), row * _cell_size.height()),
+                _cell_size
+            ) & bounds;
+            output[row * grid.width() + column] = convert_cell(source, cell, buffer);
+        }
+    }
+}
+
+std::vector<char> ImageConverter::convert(const QImage& image) const
+{
+    QSize grid = grid_size(image);
+    std::vector<char> output(grid.width() * grid.height(), ' ');
+    if ( output.empty() )
+        return output;
+
+    Source source = prepare(image);
+    int tiles = ((grid.width() + tile_cells - 1) / tile_cells) *
+                ((grid.height() + tile_cells - 1) / tile_cells);
+
+    // Tiles write to disjoint cells of the output
+    _pool.parallel_for(tiles, [this, &source, grid, &output](std::size_t tile) {
+        convert_tile(source, grid, tile, output);
+    });
+
+    return output;
+}
+
+void ImageConverter::convert(const QImage& image, doc::Layer& layer, QPoint offset) const
+{
+    QSize grid = grid_size(image);
+    std::vector<char> output = convert(image);
+    doc::Layer::EditBatch batch(layer);
+    for ( int row = 0; row < grid.height(); row++ )
+        layer.set_row(offset + QPoint(0, row), output.data() + row * grid.width(), grid.width());
+}
+
+} // namespace ascii
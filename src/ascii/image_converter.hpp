@@ -0,0 +1,190 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_ASCII_IMAGE_CONVERTER_HPP
+#define ASCEDIT_ASCII_IMAGE_CONVERTER_HPP
+
+#include <string>
+#include <vector>
+
+#include <QImage>
+#include <QRect>
+
+#include "document/layer.hpp"
+#include "glyph_atlas.hpp"
+#include "thread_pool.hpp"
+
+namespace ascii {
+
+/**
+ * \brief Image statistics of a single cell
+ */
+struct CellFeatures
+{
+    /// Mean luminance in [0, 1]
+    float luminance = 0;
+    /// Fraction of the pixels that are ink (darker than 50% gray, or
+    /// lighter when the converter is inverted)
+    float coverage = 0;
+};
+
+/**
+ * \brief Converts raster images to ASCII art
+ *
+ * The image is split in cells, one per output character, and cells are
+ * grouped in tiles which are processed in parallel on a ThreadPool.
+ * Every cell is reduced to CellFeatures and then mapped to a character
+ * from a density ramp, or when a GlyphAtlas is set, downsampled to a block
+ * and matched against the glyph shapes.
+ */
+class ImageConverter
+{
+public:
+    /**
+     * \brief Cells per tile side, matches the storage tiles of doc::Layer
+     */
+    static constexpr int tile_cells = doc::Layer::CharacterMap::tile_size;
+
+    explicit ImageConverter(QSize cell_size = QSize(8, 16),
+                            ThreadPool& pool = ThreadPool::global());
+
+    QSize cell_size() const
+    {
+        return _cell_size;
+    }
+
+    void set_cell_size(QSize cell_size)
+    {
+        _cell_size = cell_size;
+    }
+
+    const std::string& ramp() const
+    {
+        return _ramp;
+    }
+
+    /**
+     * \brief Sets the characters used for increasing amounts of ink
+     * \pre \p ramp is not empty
+     */
+    void set_ramp(std::string ramp)
+    {
+        _ramp = std::move(ramp);
+    }
+
+    bool inverted() const
+    {
+        return _inverted;
+    }
+
+    /**
+     * \brief Whether the ink is light on a dark background
+     */
+    void set_inverted(bool inverted)
+    {
+        _inverted = inverted;
+    }
+
+    float coverage_weight() const
+    {
+        return _coverage_weight;
+    }
+
+    /**
+     * \brief Sets how much CellFeatures::coverage counts when picking from
+     * the ramp, in [0, 1]
+     *
+     * At 0 only the luminance is used, so flat gray and cells half covered
+     * in ink map to the same character; higher values favour the amount
+     * of the cell which is actually ink.
+     */
+    void set_coverage_weight(float weight)
+    {
+        _coverage_weight = weight;
+    }
+
+    const GlyphAtlas* atlas() const
+    {
+        return _atlas;
+    }
+
+    /**
+     * \brief Sets the glyphs to match cells against, instead of the ramp
+     *
+     * \p atlas must outlive the converter, or be unset with nullptr.
+     */
+    void set_atlas(const GlyphAtlas* atlas)
+    {
+        _atlas = atlas;
+    }
+
+    /**
+     * \brief Size of the output in characters
+     */
+    QSize grid_size(const QImage& image) const;
+
+    /**
+     * \brief Converts \p image to rows of characters
+     * \returns grid_size(image).width() * grid_size(image).height() characters
+     */
+    std::vector<char> convert(const QImage& image) const;
+
+    /**
+     * \brief Converts \p image and writes the result to \p layer,
+     * with the first character at \p offset
+     */
+    void convert(const QImage& image, doc::Layer& layer, QPoint offset = QPoint()) const;
+
+    /**
+     * \brief Picks the character from the ramp for the given features,
+     * the ink is a mix of luminance and coverage by coverage_weight()
+     */
+    char match(const CellFeatures& features) const;
+
+private:
+    /**
+     * \brief Image data in a format the workers can read directly
+     */
+    struct Source
+    {
+        QImage image;
+        bool gray;
+    };
+
+    Source prepare(const QImage& image) const;
+    /**
+     * \brief Writes the luminance of the pixels in \p cell to \p output,
+     * transparent pixels show a white background
+     */
+    void luminance(const Source& source, QRect cell, uint8_t* output) const;
+    CellFeatures features(const uint8_t* luminance, int area) const;
+    char convert_cell(const Source& source, QRect cell, std::vector<uint8_t>& buffer) const;
+    void convert_tile(const Source& source, QSize grid, int tile, std::vector<char>& output) const;
+
+    QSize       _cell_size;
+    std::string _ramp = " .:-=+*#%@";
+    bool        _inverted = false;
+    float       _coverage_weight = 0.5;
+    const GlyphAtlas* _atlas = nullptr;
+    ThreadPool& _pool;
+};
+
+} // namespace ascii
+#endif // ASCEDIT_ASCII_IMAGE_CONVERTER_HPP
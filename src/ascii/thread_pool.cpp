@@ -0,0 +1,201 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace ascii {
+
+/**
+ * \brief Identifies the worker running on the current thread
+ */
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local std::size_t current_worker = 0;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if ( threads == 0 )
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for ( unsigned i = 0; i < threads; i++ )
+        _workers.emplace_back(new Worker);
+
+    for ( std::size_t i = 0; i < _workers.size(); i++ )
+        _workers[i]->thread = std::thread(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for ( auto& worker : _workers )
+        worker->thread.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::push(std::size_t worker, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_workers[worker]->mutex);
+        _workers[worker]->queue.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        ++_queued;
+    }
+    _wake.notify_one();
+}
+
+bool ThreadPool::pop(std::size_t worker, Task& task)
+{
+    std::lock_guard<std::mutex> lock(_workers[worker]->mutex);
+    auto& queue = _workers[worker]->queue;
+    if ( queue.empty() )
+        return false;
+    task = std::move(queue.back());
+    queue.pop_back();
+    --_queued;
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t thief, Task& task)
+{
+    for ( std::size_t i = 1; i < _workers.size(); i++ )
+    {
+        Worker& victim = *_workers[(thief + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if ( !victim.queue.empty() )
+        {
+            task = std::move(victim.queue.front());
+            victim.queue.pop_front();
+            --_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_one(std::size_t worker)
+{
+    Task task;
+    if ( pop(worker, task) || steal(worker, task) )
+    {
+        task();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::work(std::size_t worker)
+{
+    current_pool = this;
+    current_worker = worker;
+
+    while ( true )
+    {
+        if ( run_one(worker) )
+            continue;
+
+        std::unique_lock<std::mutex> lock(_sleep_mutex);
+        _wake.wait(lock, [this]{ return _stopping || _queued > 0; });
+        if ( _stopping && _queued == 0 )
+            return;
+    }
+}
+
+std::future<void> ThreadPool::submit(Task task)
+{
+    // Exceptions go to the future instead of terminating the worker,
+    // shared since Task must be copyable
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    push(_next_worker++ % _workers.size(), [packaged]{ (*packaged)(); });
+    return result;
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& function)
+{
+    if ( count == 0 )
+        return;
+
+    struct Batch
+    {
+        std::atomic<std::size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    Batch batch;
+    batch.remaining = count;
+
+    std::size_t first = _next_worker.fetch_add(count);
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        push((first + i) % _workers.size(), [&batch, &function, i]{
+            std::exception_ptr error;
+            try
+            {
+                function(i);
+            }
+            catch ( ... )
+            {
+                error = std::current_exception();
+            }
+
+            // The batch can be destroyed as soon as the mutex is released
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if ( error && !batch.error )
+                batch.error = error;
+            if ( --batch.remaining == 0 )
+                batch.finished.notify_all();
+        });
+    }
+
+    // Help out instead of blocking a thread
+    std::size_t helper = current_pool == this ? current_worker : first % _workers.size();
+    while ( batch.remaining > 0 )
+    {
+        if ( run_one(helper) )
+            continue;
+
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.finished.wait(lock, [&batch]{ return batch.remaining == 0; });
+    }
+
+    // Wait for the last task to release the mutex
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if ( batch.error )
+        std::rethrow_exception(batch.error);
+}
+
+} // namespace ascii
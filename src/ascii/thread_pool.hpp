@@ -0,0 +1,111 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_ASCII_THREAD_POOL_HPP
+#define ASCEDIT_ASCII_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ascii {
+
+/**
+ * \brief Work-stealing thread pool
+ *
+ * Each worker owns a task queue, it runs tasks from the back of its own
+ * queue and when that is empty it steals from the front of the others.
+ */
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * \param threads Number of workers, 0 to use one per hardware thread
+     */
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * \brief Number of worker threads
+     */
+    unsigned size() const
+    {
+        return _workers.size();
+    }
+
+    /**
+     * \brief Queues a task without waiting for it
+     * \returns Future set when the task has finished, holding the
+     * exception it has thrown if any
+     */
+    std::future<void> submit(Task task);
+
+    /**
+     * \brief Runs \p function for every index in [0, count) and waits for
+     * all of them to finish
+     *
+     * The calling thread runs tasks while it waits, so this can be called
+     * from within a task. If any call throws, the first exception is
+     * rethrown once all the calls have finished.
+     */
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& function);
+
+    /**
+     * \brief Shared pool using every hardware thread
+     */
+    static ThreadPool& global();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> queue;
+        std::thread thread;
+    };
+
+    void push(std::size_t worker, Task task);
+    bool pop(std::size_t worker, Task& task);
+    bool steal(std::size_t thief, Task& task);
+    bool run_one(std::size_t worker);
+    void work(std::size_t worker);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<std::size_t> _next_worker{0};
+
+    /// Number of tasks in all the queues, only incremented with _sleep_mutex held
+    std::atomic<std::size_t> _queued{0};
+    std::mutex _sleep_mutex;
+    std::condition_variable _wake;
+    bool _stopping = false;
+};
+
+} // namespace ascii
+#endif // ASCEDIT_ASCII_THREAD_POOL_HPP
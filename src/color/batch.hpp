@@ -0,0 +1,251 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_BATCH_HPP
+#define ASCEDIT_COLOR_BATCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#include "color.hpp"
+#include "kernels.hpp"
+
+namespace color {
+
+namespace detail {
+
+/**
+ * \brief Structure-of-arrays buffer used by the batch conversions
+ *
+ * Each pass over the buffer runs a single conversion stage on independent
+ * channel arrays so the compiler can vectorize it.
+ */
+struct ChannelBlock
+{
+    static constexpr std::size_t capacity = 256;
+
+    float c0[capacity];
+    float c1[capacity];
+    float c2[capacity];
+    std::size_t size = 0;
+
+    template<class Stage>
+        void apply(Stage stage)
+    {
+        for ( std::size_t i = 0; i < size; i++ )
+            stage(c0[i], c1[i], c2[i]);
+    }
+
+    /**
+     * \brief Loads the colors as linear-light RGB
+     */
+    void load_linear(const Color* colors, std::size_t count)
+    {
+        size = count;
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            c0[i] = kernel::srgb8_to_linear(colors[i].red());
+            c1[i] = kernel::srgb8_to_linear(colors[i].green());
+            c2[i] = kernel::srgb8_to_linear(colors[i].blue());
+        }
+    }
+
+    template<class Repr, class Member>
+        void load(const Repr* input, std::size_t count,
+                  Member m0, Member m1, Member m2)
+    {
+        size = count;
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            c0[i] = input[i].*m0;
+            c1[i] = input[i].*m1;
+            c2[i] = input[i].*m2;
+        }
+    }
+
+    template<class Repr>
+        void store(Repr* output) const
+    {
+        for ( std::size_t i = 0; i < size; i++ )
+            output[i] = Repr(c0[i], c1[i], c2[i]);
+    }
+
+    /**
+     * \brief Stores linear-light RGB in [0, 1] as colors
+     */
+    void store_linear(Color* output, uint8_t alpha)
+    {
+        kernel::linear_to_srgb(c0, size);
+        kernel::linear_to_srgb(c1, size);
+        kernel::linear_to_srgb(c2, size);
+        for ( std::size_t i = 0; i < size; i++ )
+            output[i] = Color(
+                srgb_to_8bit(c0[i]),
+                srgb_to_8bit(c1[i]),
+                srgb_to_8bit(c2[i]),
+                alpha
+            );
+    }
+};
+
+/**
+ * \brief Runs \p function on consecutive chunks of at most
+ * ChannelBlock::capacity elements
+ */
+template<class Input, class Output, class Function>
+    void for_each_block(const Input* begin, const Input* end, Output* output,
+                        Function function)
+{
+    while ( begin < end )
+    {
+        std::size_t count = std::min<std::size_t>(
+            end - begin, std::size_t(ChannelBlock::capacity));
+        function(begin, count, output);
+        begin += count;
+        output += count;
+    }
+}
+
+} // namespace detail
+
+/**
+ * \brief Converts the colors in [begin, end) to \p Repr
+ * \param output Buffer with room for end - begin elements
+ * \note This operation is only defined for valid colors
+ */
+template<class Repr>
+    void convert(const Color* begin, const Color* end, Repr* output)
+{
+    std::transform(begin, end, output, [](const Color& color) {
+        return color.to<Repr>();
+    });
+}
+
+/**
+ * \brief Converts the values in [begin, end) to Color
+ * \param output Buffer with room for end - begin elements
+ * \param alpha  Alpha of the resulting colors
+ */
+template<class Repr>
+    void convert(const Repr* begin, const Repr* end, Color* output,
+                 uint8_t alpha = 255)
+{
+    std::transform(begin, end, output, [alpha](const Repr& value) {
+        return Color(value, alpha);
+    });
+}
+
+inline void convert(const Color* begin, const Color* end, Color* output)
+{
+    std::copy(begin, end, output);
+}
+
+inline void convert(const Color* begin, const Color* end, repr::XYZ* output)
+{
+    detail::ChannelBlock block;
+    detail::for_each_block(begin, end, output,
+        [&block](const Color* input, std::size_t count, repr::XYZ* output) {
+            block.load_linear(input, count);
+            block.apply(detail::linear_rgb_to_xyz);
+            block.store(output);
+        }
+    );
+}
+
+inline void convert(const Color* begin, const Color* end, repr::Lab* output)
+{
+    detail::ChannelBlock block;
+    detail::for_each_block(begin, end, output,
+        [&block](const Color* input, std::size_t count, repr::Lab* output) {
+            block.load_linear(input, count);
+            block.apply(detail::linear_rgb_to_xyz);
+            block.apply(detail::xyz_to_relative);
+            kernel::lab_f(block.c0, count);
+            kernel::lab_f(block.c1, count);
+            kernel::lab_f(block.c2, count);
+            block.apply(detail::lab_from_f);
+            block.store(output);
+        }
+    );
+}
+
+inline void convert(const repr::XYZ* begin, const repr::XYZ* end, Color* output,
+                    uint8_t alpha = 255)
+{
+    detail::ChannelBlock block;
+    detail::for_each_block(begin, end, output,
+        [&block, alpha](const repr::XYZ* input, std::size_t count, Color* output) {
+            block.load(input, count, &repr::XYZ::x, &repr::XYZ::y, &repr::XYZ::z);
+            block.apply(detail::xyz_to_linear_rgb);
+            block.store_linear(output, alpha);
+        }
+    );
+}
+
+inline void convert(const repr::Lab* begin, const repr::Lab* end, Color* output,
+                    uint8_t alpha = 255)
+{
+    detail::ChannelBlock block;
+    detail::for_each_block(begin, end, output,
+        [&block, alpha](const repr::Lab* input, std::size_t count, Color* output) {
+            block.load(input, count, &repr::Lab::l, &repr::Lab::a, &repr::Lab::b);
+            block.apply(detail::lab_to_xyz);
+            block.apply(detail::xyz_to_linear_rgb);
+            block.store_linear(output, alpha);
+        }
+    );
+}
+
+/**
+ * \brief Rotates the hue of the colors in [begin, end) by \p turn,
+ * in 1/65536 of a full turn, keeping their alpha
+ *
+ * Works on repr::HSV so it doesn't need floating point conversions,
+ * a turn of 0 gives back the same colors.
+ * \param output Buffer with room for end - begin elements
+ * \note This operation is only defined for valid colors
+ */
+inline void rotate_hue(const Color* begin, const Color* end, Color* output, uint16_t turn)
+{
+    std::transform(begin, end, output, [turn](const Color& color) {
+        repr::HSV hsv = color.to<repr::HSV>();
+        hsv.h += turn;
+        return Color(hsv, color.alpha());
+    });
+}
+
+/**
+ * \brief Converts between two representations going through Color
+ * \param output Buffer with room for end - begin elements
+ */
+template<class From, class To>
+    void convert(const From* begin, const From* end, To* output)
+{
+    Color buffer[detail::ChannelBlock::capacity];
+    detail::for_each_block(begin, end, output,
+        [&buffer](const From* input, std::size_t count, To* output) {
+            convert(input, input + count, buffer);
+            convert(buffer, buffer + count, output);
+        }
+    );
+}
+
+} // namespace color
+#endif // ASCEDIT_COLOR_BATCH_HPP
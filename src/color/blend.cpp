@@ -0,0 +1,593 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "blend.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "batch.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define ASCEDIT_BLEND_X86
+#   include <immintrin.h>
+#endif
+
+namespace color {
+namespace blend {
+
+namespace {
+
+/**
+ * \brief Colors processed at a time by blend::linear() and blend::lab()
+ */
+constexpr std::size_t block_size = 256;
+
+/**
+ * \brief Set of integer kernels for one instruction set
+ */
+struct KernelSet
+{
+    const char* name;
+    void (*rgb)(const uint32_t*, const uint32_t*, uint32_t*, std::size_t, uint32_t);
+    void (*premultiply)(const uint32_t*, uint32_t*, std::size_t);
+    void (*over)(const uint32_t*, uint32_t*, std::size_t);
+    void (*interpolate)(const uint16_t*, const uint16_t*, uint16_t*, std::size_t, uint32_t);
+};
+
+/**
+ * \brief Rounded x / 255 for x in [0, 255 * 255]
+ */
+inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * \brief Replaces invalid_argb with the value PackedColor stores instead
+ */
+inline uint32_t valid(uint32_t argb)
+{
+    return PackedColor::valid_argb(argb);
+}
+
+// The scalar kernels define the results, the vector ones perform the same
+// integer operations on 16 bit lanes.
+
+void rgb_scalar(const uint32_t* a, const uint32_t* b, uint32_t* output,
+                std::size_t count, uint32_t weight)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        uint32_t result = 0;
+        for ( int shift = 0; shift < 32; shift += 8 )
+        {
+            uint32_t from = (a[i] >> shift) & 0xff;
+            uint32_t to = (b[i] >> shift) & 0xff;
+            result |= ((from * (256 - weight) + to * weight + 128) >> 8) << shift;
+        }
+        output[i] = valid(result);
+    }
+}
+
+void premultiply_scalar(const uint32_t* input, uint32_t* output, std::size_t count)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        uint32_t alpha = input[i] >> 24;
+        uint32_t result = alpha << 24;
+        for ( int shift = 0; shift < 24; shift += 8 )
+            result |= div255(((input[i] >> shift) & 0xff) * alpha) << shift;
+        output[i] = valid(result);
+    }
+}
+
+void over_scalar(const uint32_t* source, uint32_t* destination, std::size_t count)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        uint32_t inverse = 255 - (source[i] >> 24);
+        uint32_t result = 0;
+        for ( int shift = 0; shift < 32; shift += 8 )
+        {
+            uint32_t channel = ((source[i] >> shift) & 0xff) +
+                div255(((destination[i] >> shift) & 0xff) * inverse);
+            result |= std::min<uint32_t>(channel, 255) << shift;
+        }
+        destination[i] = valid(result);
+    }
+}
+
+/**
+ * \brief Interpolates 16 bit values with a 16 bit fixed-point \p weight
+ *
+ * The vector versions need 0 < weight < 65536, where both weights fit
+ * in 16 bit lanes; interpolate() handles the other cases.
+ */
+void interpolate_scalar(const uint16_t* from, const uint16_t* to, uint16_t* output,
+                        std::size_t count, uint32_t weight)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+        output[i] = (from[i] * (65536 - weight) + to[i] * weight + 32768) >> 16;
+}
+
+#ifdef ASCEDIT_BLEND_X86
+
+__attribute__((target("sse2")))
+__m128i div255_sse2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+__m128i valid_sse2(__m128i argb)
+{
+    __m128i invalid = _mm_cmpeq_epi32(argb, _mm_set1_epi32(invalid_argb));
+    return _mm_xor_si128(argb, _mm_and_si128(invalid, _mm_set1_epi32(1)));
+}
+
+/**
+ * \brief Alpha of each pixel repeated on its four 16 bit lanes
+ */
+__attribute__((target("sse2")))
+__m128i alpha_sse2(__m128i wide)
+{
+    wide = _mm_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("sse2")))
+void rgb_sse2(const uint32_t* a, const uint32_t* b, uint32_t* output,
+              std::size_t count, uint32_t weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i to_weight = _mm_set1_epi16(weight);
+    const __m128i from_weight = _mm_set1_epi16(256 - weight);
+    const __m128i half = _mm_set1_epi16(128);
+
+    std::size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i from = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i to = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i low = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(from, zero), from_weight),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(to, zero), to_weight)
+        );
+        __m128i high = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(from, zero), from_weight),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(to, zero), to_weight)
+        );
+        low = _mm_srli_epi16(_mm_add_epi16(low, half), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, half), 8);
+        __m128i result = valid_sse2(_mm_packus_epi16(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), result);
+    }
+    rgb_scalar(a + i, b + i, output + i, count - i, weight);
+}
+
+__attribute__((target("sse2")))
+void premultiply_sse2(const uint32_t* input, uint32_t* output, std::size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+
+    std::size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        low = div255_sse2(_mm_mullo_epi16(low, alpha_sse2(low)));
+        high = div255_sse2(_mm_mullo_epi16(high, alpha_sse2(high)));
+        __m128i result = _mm_or_si128(
+            _mm_andnot_si128(alpha_mask, _mm_packus_epi16(low, high)),
+            _mm_and_si128(alpha_mask, pixels)
+        );
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), valid_sse2(result));
+    }
+    premultiply_scalar(input + i, output + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void over_sse2(const uint32_t* source, uint32_t* destination, std::size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi16(255);
+
+    std::size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i dst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + i));
+        __m128i low = _mm_unpacklo_epi8(src, zero);
+        __m128i high = _mm_unpackhi_epi8(src, zero);
+        low = _mm_sub_epi16(opaque, alpha_sse2(low));
+        high = _mm_sub_epi16(opaque, alpha_sse2(high));
+        low = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), low));
+        high = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), high));
+        __m128i result = _mm_adds_epu8(src, _mm_packus_epi16(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), valid_sse2(result));
+    }
+    over_scalar(source + i, destination + i, count - i);
+}
+
+/**
+ * \brief Sum of the 32 bit products of 16 bit lanes, from the low and
+ * high halves of the products
+ */
+__attribute__((target("sse2")))
+__m128i weighted_sse2(__m128i low, __m128i high, __m128i low_to, __m128i high_to,
+                      bool upper)
+{
+    __m128i from = upper ? _mm_unpackhi_epi16(low, high) : _mm_unpacklo_epi16(low, high);
+    __m128i to = upper ? _mm_unpackhi_epi16(low_to, high_to) : _mm_unpacklo_epi16(low_to, high_to);
+    // The sum fits in 32 unsigned bits, the arithmetic shift keeps the
+    // top 16 bits as they are for the signed pack
+    __m128i sum = _mm_add_epi32(_mm_add_epi32(from, to), _mm_set1_epi32(32768));
+    return _mm_srai_epi32(sum, 16);
+}
+
+__attribute__((target("sse2")))
+void interpolate_sse2(const uint16_t* from, const uint16_t* to, uint16_t* output,
+                      std::size_t count, uint32_t weight)
+{
+    const __m128i to_weight = _mm_set1_epi16(short(weight));
+    const __m128i from_weight = _mm_set1_epi16(short(65536 - weight));
+
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+        __m128i a_low = _mm_mullo_epi16(a, from_weight);
+        __m128i a_high = _mm_mulhi_epu16(a, from_weight);
+        __m128i b_low = _mm_mullo_epi16(b, to_weight);
+        __m128i b_high = _mm_mulhi_epu16(b, to_weight);
+        __m128i result = _mm_packs_epi32(
+            weighted_sse2(a_low, a_high, b_low, b_high, false),
+            weighted_sse2(a_low, a_high, b_low, b_high, true)
+        );
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), result);
+    }
+    interpolate_scalar(from + i, to + i, output + i, count - i, weight);
+}
+
+__attribute__((target("avx2")))
+__m256i div255_avx2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+__m256i valid_avx2(__m256i argb)
+{
+    __m256i invalid = _mm256_cmpeq_epi32(argb, _mm256_set1_epi32(invalid_argb));
+    return _mm256_xor_si256(argb, _mm256_and_si256(invalid, _mm256_set1_epi32(1)));
+}
+
+__attribute__((target("avx2")))
+__m256i alpha_avx2(__m256i wide)
+{
+    wide = _mm256_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Unpacking and packing work within 128 bit lanes, so the pixel order is kept
+
+__attribute__((target("avx2")))
+void rgb_avx2(const uint32_t* a, const uint32_t* b, uint32_t* output,
+              std::size_t count, uint32_t weight)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i to_weight = _mm256_set1_epi16(weight);
+    const __m256i from_weight = _mm256_set1_epi16(256 - weight);
+    const __m256i half = _mm256_set1_epi16(128);
+
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256i from = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i to = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i low = _mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(from, zero), from_weight),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(to, zero), to_weight)
+        );
+        __m256i high = _mm256_add_epi16(
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(from, zero), from_weight),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(to, zero), to_weight)
+        );
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, half), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, half), 8);
+        __m256i result = valid_avx2(_mm256_packus_epi16(low, high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), result);
+    }
+    rgb_sse2(a + i, b + i, output + i, count - i, weight);
+}
+
+__attribute__((target("avx2")))
+void premultiply_avx2(const uint32_t* input, uint32_t* output, std::size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i low = _mm256_unpacklo_epi8(pixels, zero);
+        __m256i high = _mm256_unpackhi_epi8(pixels, zero);
+        low = div255_avx2(_mm256_mullo_epi16(low, alpha_avx2(low)));
+        high = div255_avx2(_mm256_mullo_epi16(high, alpha_avx2(high)));
+        __m256i result = _mm256_blendv_epi8(
+            _mm256_packus_epi16(low, high), pixels, alpha_mask
+        );
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), valid_avx2(result));
+    }
+    premultiply_sse2(input + i, output + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void over_avx2(const uint32_t* source, uint32_t* destination, std::size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i opaque = _mm256_set1_epi16(255);
+
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+        __m256i dst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + i));
+        __m256i low = _mm256_unpacklo_epi8(src, zero);
+        __m256i high = _mm256_unpackhi_epi8(src, zero);
+        low = _mm256_sub_epi16(opaque, alpha_avx2(low));
+        high = _mm256_sub_epi16(opaque, alpha_avx2(high));
+        low = div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), low));
+        high = div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), high));
+        __m256i result = _mm256_adds_epu8(src, _mm256_packus_epi16(low, high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), valid_avx2(result));
+    }
+    over_sse2(source + i, destination + i, count - i);
+}
+
+__attribute__((target("avx2")))
+__m256i weighted_avx2(__m256i low, __m256i high, __m256i low_to, __m256i high_to,
+                      bool upper)
+{
+    __m256i from = upper ? _mm256_unpackhi_epi16(low, high) : _mm256_unpacklo_epi16(low, high);
+    __m256i to = upper ? _mm256_unpackhi_epi16(low_to, high_to) : _mm256_unpacklo_epi16(low_to, high_to);
+    __m256i sum = _mm256_add_epi32(_mm256_add_epi32(from, to), _mm256_set1_epi32(32768));
+    return _mm256_srai_epi32(sum, 16);
+}
+
+__attribute__((target("avx2")))
+void interpolate_avx2(const uint16_t* from, const uint16_t* to, uint16_t* output,
+                      std::size_t count, uint32_t weight)
+{
+    const __m256i to_weight = _mm256_set1_epi16(short(weight));
+    const __m256i from_weight = _mm256_set1_epi16(short(65536 - weight));
+
+    std::size_t i = 0;
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(to + i));
+        __m256i a_low = _mm256_mullo_epi16(a, from_weight);
+        __m256i a_high = _mm256_mulhi_epu16(a, from_weight);
+        __m256i b_low = _mm256_mullo_epi16(b, to_weight);
+        __m256i b_high = _mm256_mulhi_epu16(b, to_weight);
+        __m256i result = _mm256_packs_epi32(
+            weighted_avx2(a_low, a_high, b_low, b_high, false),
+            weighted_avx2(a_low, a_high, b_low, b_high, true)
+        );
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), result);
+    }
+    interpolate_sse2(from + i, to + i, output + i, count - i, weight);
+}
+
+#endif // ASCEDIT_BLEND_X86
+
+KernelSet select_kernels()
+{
+#ifdef ASCEDIT_BLEND_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") )
+        return {"avx2", rgb_avx2, premultiply_avx2, over_avx2, interpolate_avx2};
+    if ( __builtin_cpu_supports("sse2") )
+        return {"sse2", rgb_sse2, premultiply_sse2, over_sse2, interpolate_sse2};
+#endif
+    return {"scalar", rgb_scalar, premultiply_scalar, over_scalar, interpolate_scalar};
+}
+
+const KernelSet& kernels()
+{
+    static const KernelSet selected = select_kernels();
+    return selected;
+}
+
+const uint32_t* words(const PackedColor* colors)
+{
+    return reinterpret_cast<const uint32_t*>(colors);
+}
+
+uint32_t* words(PackedColor* colors)
+{
+    return reinterpret_cast<uint32_t*>(colors);
+}
+
+/**
+ * \brief Conversions between 8 bit sRGB and 16 bit linear-light channels
+ *
+ * 16 bits keep the error under one unit of the 8 bit result,
+ * even for dark colors where sRGB is steepest.
+ */
+struct LinearTables
+{
+    uint16_t to_linear[256];
+    uint8_t to_srgb[1 << 16];
+};
+
+const LinearTables& linear_tables()
+{
+    static const LinearTables tables = []{
+        LinearTables tables;
+        for ( int i = 0; i < 256; i++ )
+            tables.to_linear[i] = melanolib::math::round<uint16_t>(kernel::srgb8_to_linear(i) / 100 * 65535);
+
+        std::vector<float> srgb(1 << 16);
+        for ( std::size_t i = 0; i < srgb.size(); i++ )
+            srgb[i] = i / 65535.f;
+        kernel::linear_to_srgb(srgb.data(), srgb.size());
+        for ( std::size_t i = 0; i < srgb.size(); i++ )
+            tables.to_srgb[i] = color::detail::srgb_to_8bit(srgb[i]);
+        return tables;
+    }();
+    return tables;
+}
+
+/**
+ * \brief Alpha as blended by Color::blend()
+ */
+uint8_t blend_alpha(const PackedColor& a, const PackedColor& b, float factor)
+{
+    return melanolib::math::round<uint8_t>(
+        melanolib::math::linear_interpolation(a.alpha() / 255.f, b.alpha() / 255.f, factor) * 255
+    );
+}
+
+/**
+ * \brief Interpolates with the selected kernel, copying when \p weight is
+ * 0 or 65536 since the vector kernels can't represent those
+ */
+void interpolate(const uint16_t* from, const uint16_t* to, uint16_t* output,
+                 std::size_t count, uint32_t weight)
+{
+    if ( weight == 0 )
+        std::copy(from, from + count, output);
+    else if ( weight >= 65536 )
+        std::copy(to, to + count, output);
+    else
+        kernels().interpolate(from, to, output, count, weight);
+}
+
+} // namespace
+
+void rgb(const PackedColor* a, const PackedColor* b, PackedColor* output,
+         std::size_t count, float factor)
+{
+    uint32_t weight = melanolib::math::round<uint32_t>(melanolib::math::bound(0.f, factor, 1.f) * 256);
+    kernels().rgb(words(a), words(b), words(output), count, weight);
+}
+
+void linear(const PackedColor* a, const PackedColor* b, PackedColor* output,
+            std::size_t count, float factor)
+{
+    const LinearTables& tables = linear_tables();
+    uint32_t weight = melanolib::math::round<uint32_t>(melanolib::math::bound(0.f, factor, 1.f) * 65536);
+    uint16_t from[block_size * 3];
+    uint16_t to[block_size * 3];
+
+    // The lookups are scalar, the interpolation is vectorized
+    for ( std::size_t start = 0; start < count; start += block_size )
+    {
+        std::size_t size = std::min(block_size, count - start);
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            const PackedColor& x = a[start + i];
+            const PackedColor& y = b[start + i];
+            from[i * 3] = tables.to_linear[x.red()];
+            from[i * 3 + 1] = tables.to_linear[x.green()];
+            from[i * 3 + 2] = tables.to_linear[x.blue()];
+            to[i * 3] = tables.to_linear[y.red()];
+            to[i * 3 + 1] = tables.to_linear[y.green()];
+            to[i * 3 + 2] = tables.to_linear[y.blue()];
+        }
+
+        interpolate(from, to, from, size * 3, weight);
+
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            uint8_t alpha = blend_alpha(a[start + i], b[start + i], factor);
+            output[start + i] = PackedColor(
+                tables.to_srgb[from[i * 3]],
+                tables.to_srgb[from[i * 3 + 1]],
+                tables.to_srgb[from[i * 3 + 2]],
+                alpha
+            );
+        }
+    }
+}
+
+void lab(const PackedColor* a, const PackedColor* b, PackedColor* output,
+         std::size_t count, float factor)
+{
+    using melanolib::math::linear_interpolation;
+    Color colors[block_size];
+    repr::Lab from_lab[block_size];
+    repr::Lab to_lab[block_size];
+
+    for ( std::size_t start = 0; start < count; start += block_size )
+    {
+        std::size_t size = std::min(block_size, count - start);
+        unpack(a + start, a + start + size, colors);
+        convert(colors, colors + size, from_lab);
+        unpack(b + start, b + start + size, colors);
+        convert(colors, colors + size, to_lab);
+
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            from_lab[i] = repr::Lab(
+                linear_interpolation(from_lab[i].l, to_lab[i].l, factor),
+                linear_interpolation(from_lab[i].a, to_lab[i].a, factor),
+                linear_interpolation(from_lab[i].b, to_lab[i].b, factor)
+            );
+        }
+        convert(from_lab, from_lab + size, colors);
+
+        for ( std::size_t i = 0; i < size; i++ )
+        {
+            uint8_t alpha = blend_alpha(a[start + i], b[start + i], factor);
+            output[start + i] = PackedColor(colors[i].red(), colors[i].green(), colors[i].blue(), alpha);
+        }
+    }
+}
+
+void premultiply(const PackedColor* input, PackedColor* output, std::size_t count)
+{
+    kernels().premultiply(words(input), words(output), count);
+}
+
+void over(const PackedColor* source, PackedColor* destination, std::size_t count)
+{
+    kernels().over(words(source), words(destination), count);
+}
+
+const char* instruction_set()
+{
+    return kernels().name;
+}
+
+} // namespace blend
+} // namespace color
@@ -0,0 +1,90 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_BLEND_HPP
+#define ASCEDIT_COLOR_BLEND_HPP
+
+#include <cstddef>
+
+#include "packed_color.hpp"
+
+namespace color {
+
+/**
+ * \brief Blending and compositing of arrays of colors
+ *
+ * The blend functions compute output[i] = a[i].blend<Repr>(b[i], factor)
+ * for a whole span at once, Color::blend() is the reference for their
+ * results. Integer kernels use SSE2 or AVX2 when available, choosing at
+ * run time and giving identical results with every instruction set.
+ *
+ * Results which would be invalid_argb are adjusted as in PackedColor.
+ * Output may alias either input, factors are expected to be in [0, 1].
+ */
+namespace blend {
+
+/**
+ * \brief Blends in sRGB with 8 bit fixed-point weights
+ *
+ * Same as Color::blend<repr::RGBf>() within one unit per channel.
+ */
+void rgb(const PackedColor* a, const PackedColor* b, PackedColor* output,
+         std::size_t count, float factor);
+
+/**
+ * \brief Blends in linear-light RGB
+ *
+ * Uses lookup tables between sRGB and 16 bit linear values, built on the
+ * first call. The lookups are scalar, the interpolation between them uses
+ * the integer kernels. Same as Color::blend<repr::XYZ>() within one unit
+ * per channel.
+ */
+void linear(const PackedColor* a, const PackedColor* b, PackedColor* output,
+            std::size_t count, float factor);
+
+/**
+ * \brief Blends in CIE L*a*b
+ *
+ * Same as Color::blend<repr::Lab>(), using the batch conversions.
+ */
+void lab(const PackedColor* a, const PackedColor* b, PackedColor* output,
+         std::size_t count, float factor);
+
+/**
+ * \brief Multiplies the color channels by alpha, rounding to nearest
+ */
+void premultiply(const PackedColor* input, PackedColor* output, std::size_t count);
+
+/**
+ * \brief Porter-Duff "source over destination" on premultiplied colors
+ *
+ * destination[i] = source[i] + destination[i] * (255 - source[i].alpha()) / 255
+ * for each channel, with the product rounded to nearest.
+ */
+void over(const PackedColor* source, PackedColor* destination, std::size_t count);
+
+/**
+ * \brief Name of the instruction set used by the integer kernels
+ */
+const char* instruction_set();
+
+} // namespace blend
+} // namespace color
+#endif // ASCEDIT_COLOR_BLEND_HPP
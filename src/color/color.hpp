@@ -21,11 +21,13 @@
 #ifndef MELANO_COLOR_HPP
 #define MELANO_COLOR_HPP
 
+#include <cmath>
 #include <cstdint>
 #include <string>
 #include <ostream>
 #include "melanolib/math/math.hpp"
 #include "melanolib/math/vector.hpp"
+#include "kernels.hpp"
 
 namespace color {
 
@@ -54,6 +56,7 @@ struct RGBf
 
     constexpr RGBf(float r, float g, float b) : r(r), g(g), b(b) {}
     constexpr RGBf(const melanolib::math::Vec3f& v) : r(v[0]), g(v[1]), b(v[2]) {}
+    constexpr RGBf() : r(0), g(0), b(0) {}
     constexpr melanolib::math::Vec3f vec() const { return {r, g, b}; }
 };
 
@@ -66,9 +69,25 @@ struct HSVf
 
     constexpr HSVf(float h, float s, float v) : h(h), s(s), v(v) {}
     constexpr HSVf(const melanolib::math::Vec3f& v) : h(v[0]), s(v[1]), v(v[2]) {}
+    constexpr HSVf() : h(0), s(0), v(0) {}
     constexpr melanolib::math::Vec3f vec() const { return {h, s, v}; }
 };
 
+/**
+ * \brief Fixed-point HSV
+ *
+ * Hue in 1/65536 of a turn, so adding to it wraps around the color wheel,
+ * saturation and value in [0, 255].
+ */
+struct HSV
+{
+    uint16_t h;
+    uint8_t s, v;
+
+    constexpr HSV(uint16_t h, uint8_t s, uint8_t v) : h(h), s(s), v(v) {}
+    constexpr HSV() : h(0), s(0), v(0) {}
+};
+
 /**
  * \brief CIE L*a*b
  * L* [0, 100]
@@ -81,7 +100,8 @@ struct Lab
 
     constexpr Lab(float l, float a, float b) : l(l), a(a), b(b) {}
     constexpr Lab(const melanolib::math::Vec3f& v) : l(v[0]), a(v[1]), b(v[2]) {}
-    constexpr melanolib::math::Vec3f vec() const { return {l, b, b}; }
+    constexpr Lab() : l(0), a(0), b(0) {}
+    constexpr melanolib::math::Vec3f vec() const { return {l, a, b}; }
 };
 
 /**
@@ -93,6 +113,7 @@ struct XYZ
 
     constexpr XYZ(float x, float y, float z) : x(x), y(y), z(z) {}
     constexpr XYZ(const melanolib::math::Vec3f& v) : x(v[0]), y(v[1]), z(v[2]) {}
+    constexpr XYZ() : x(0), y(0), z(0) {}
     constexpr melanolib::math::Vec3f vec() const { return {x, y, z}; }
 };
 
@@ -138,6 +159,143 @@ struct RGB_int3
 
 } // namespace repr
 
+/**
+ * \brief Conversion stages shared by Color and the batch conversions
+ *
+ * Each stage transforms a triplet of channels in place so the same code
+ * can be applied to a single color or to structure-of-arrays buffers,
+ * giving bit-identical results in both cases.
+ * Transfer functions are in color::kernel.
+ */
+namespace detail {
+
+/**
+ * \brief D65 reference white
+ */
+constexpr float xyz_white_x = 95.047;
+constexpr float xyz_white_y = 100.000;
+constexpr float xyz_white_z = 108.883;
+
+/**
+ * \brief Linear-light RGB in [0, 100] to XYZ
+ */
+constexpr void linear_rgb_to_xyz(float& r_x, float& g_y, float& b_z)
+{
+    float r = r_x, g = g_y, b = b_z;
+    r_x = r * 0.4124f + g * 0.3576f + b * 0.1805f;
+    g_y = r * 0.2126f + g * 0.7152f + b * 0.0722f;
+    b_z = r * 0.0193f + g * 0.1192f + b * 0.9505f;
+}
+
+/**
+ * \brief XYZ to linear-light RGB in [0, 1]
+ */
+constexpr void xyz_to_linear_rgb(float& x_r, float& y_g, float& z_b)
+{
+    float x = x_r / 100;
+    float y = y_g / 100;
+    float z = z_b / 100;
+    x_r = x *  3.2406f + y * -1.5372f + z * -0.4986f;
+    y_g = x * -0.9689f + y *  1.8758f + z *  0.0415f;
+    z_b = x *  0.0557f + y * -0.2040f + z *  1.0570f;
+}
+
+/**
+ * \brief sRGB to an 8 bit channel, clamping values outside [0, 1]
+ *
+ * Lab and XYZ colors can be outside the sRGB gamut, as blending in those
+ * spaces may produce.
+ */
+constexpr uint8_t srgb_to_8bit(float v)
+{
+    return melanolib::math::round<uint8_t>(melanolib::math::bound(0.f, v, 1.f) * 255);
+}
+
+/**
+ * \brief XYZ relative to the reference white, input of kernel::lab_f()
+ */
+constexpr void xyz_to_relative(float& x, float& y, float& z)
+{
+    x /= xyz_white_x;
+    y /= xyz_white_y;
+    z /= xyz_white_z;
+}
+
+/**
+ * \brief Lab from relative XYZ after kernel::lab_f()
+ */
+constexpr void lab_from_f(float& x_l, float& y_a, float& z_b)
+{
+    float x = x_l, y = y_a, z = z_b;
+    x_l = (116 * y) - 16;
+    y_a = 500 * (x - y);
+    z_b = 200 * (y - z);
+}
+
+/**
+ * \brief Inverse of kernel::lab_f()
+ */
+constexpr float lab_f_inverse(float v)
+{
+    float v3 = v * v * v;
+    return v3 > 0.008856f ? v3 : (v - 16.0f / 116) / 7.787f;
+}
+
+constexpr void lab_to_xyz(float& l_x, float& a_y, float& b_z)
+{
+    float y = ( l_x + 16 ) / 116;
+    float x = a_y / 500 + y;
+    float z = y - b_z / 200;
+    l_x = lab_f_inverse(x) * xyz_white_x;
+    a_y = lab_f_inverse(y) * xyz_white_y;
+    b_z = lab_f_inverse(z) * xyz_white_z;
+}
+
+/**
+ * \brief Tables for the fixed-point conversions to and from repr::HSV
+ */
+struct HSVTables
+{
+    /// 2^32 / (6 * delta), turns a hue offset over delta into 1/65536 of a turn
+    uint32_t hue_reciprocal[256];
+    /// 255 * 2^16 / max, turns delta into saturation
+    uint32_t saturation_reciprocal[256];
+    /// For each sector, the index of the channel in {v, k, m, n} used for r, g, b
+    uint8_t sector_channels[6][3];
+
+    constexpr HSVTables()
+        : hue_reciprocal{}, saturation_reciprocal{},
+          sector_channels{{0, 1, 2}, {3, 0, 2}, {2, 0, 1}, {2, 3, 0}, {1, 2, 0}, {0, 2, 3}}
+    {
+        for ( uint32_t i = 1; i < 256; i++ )
+        {
+            hue_reciprocal[i] = ((uint64_t(1) << 32) + 3 * i) / (6 * i);
+            saturation_reciprocal[i] = (255 * 0x10000 + i / 2) / i;
+        }
+    }
+};
+
+template<class = void>
+    struct HSVTablesHolder
+{
+    static constexpr HSVTables tables{};
+};
+
+template<class T>
+    constexpr HSVTables HSVTablesHolder<T>::tables;
+
+} // namespace detail
+
+/**
+ * \brief Formula used to measure the difference between two colors
+ */
+enum class DeltaE
+{
+    CIE76,      ///< Euclidean distance in Lab, the cheapest
+    CIE94,      ///< CIE76 corrected for chroma and hue, for graphic arts
+    CIEDE2000,  ///< Most accurate and most expensive
+};
+
 class Color
 {
 public:
@@ -236,10 +394,11 @@ public:
 
     /**
      * \brief Distance between two colors
-     * Uses Lab color space to determine the distance
+     * Uses Lab color space to determine the distance,
+     * for DeltaE::CIE94 this color is the reference
      * \note This operation is only defined for valid colors
      */
-    float distance(const Color& oth) const;
+    float distance(const Color& oth, DeltaE metric = DeltaE::CIE76) const;
 
     template<class Repr=repr::RGBf>
         constexpr Color blend(const Color& oth, float factor = 0.5) const
@@ -332,6 +491,27 @@ template<>
     }
 }
 
+template<>
+    inline constexpr void Color::from<repr::HSV>(repr::HSV value)
+{
+    const detail::HSVTables& tables = detail::HSVTablesHolder<>::tables;
+
+    // The sector ends up in the high 16 bits, the position within it in the low ones
+    uint32_t h6 = value.h * 6u;
+    uint32_t sector = h6 >> 16;
+    uint32_t f = h6 & 0xffff;
+    uint32_t c = (value.v * value.s + 127) / 255;
+
+    uint8_t channels[4] = {
+        value.v,
+        uint8_t(value.v - ((c * (0x10000 - f) + 0x8000) >> 16)),
+        uint8_t(value.v - c),
+        uint8_t(value.v - ((c * f + 0x8000) >> 16)),
+    };
+    const uint8_t* order = tables.sector_channels[sector];
+    _rgb = repr::RGB(channels[order[0]], channels[order[1]], channels[order[2]]);
+}
+
 template<>
     inline constexpr void Color::from<repr::RGB_int24>(repr::RGB_int24 value)
 {
@@ -372,46 +552,26 @@ template<>
 }
 
 template<>
-    inline void Color::from<repr::XYZ>(repr::XYZ value)
+    inline constexpr void Color::from<repr::XYZ>(repr::XYZ value)
 {
-    value.x /= 100;
-    value.y /= 100;
-    value.z /= 100;
-
-    float r = value.x *  3.2406 + value.y * -1.5372 + value.z * -0.4986;
-    float g = value.x * -0.9689 + value.y *  1.8758 + value.z *  0.0415;
-    float b = value.x *  0.0557 + value.y * -0.2040 + value.z *  1.0570;
-
-    auto conv = [](float v)
-    {
-        return v > 0.0031308 ?
-            1.055 * melanolib::math::pow(v, 1 / 2.4) - 0.055 :
-            12.92 * v;
-    };
-
-    _rgb.r = melanolib::math::round<uint8_t>(conv(r) * 255);
-    _rgb.g = melanolib::math::round<uint8_t>(conv(g) * 255);
-    _rgb.b = melanolib::math::round<uint8_t>(conv(b) * 255);
+    detail::xyz_to_linear_rgb(value.x, value.y, value.z);
+    _rgb.r = detail::srgb_to_8bit(kernel::linear_to_srgb(value.x));
+    _rgb.g = detail::srgb_to_8bit(kernel::linear_to_srgb(value.y));
+    _rgb.b = detail::srgb_to_8bit(kernel::linear_to_srgb(value.z));
 }
 
 template<>
-    inline void Color::from<repr::Lab>(repr::Lab value)
+    inline constexpr void Color::from<repr::Lab>(repr::Lab value)
 {
-    repr::XYZ ref{95.047, 100.000, 108.883};
-
-    float y = ( value.l + 16 ) / 116;
-    float x = value.a / 500 + y;
-    float z = y - value.b / 200;
-
-    auto conv = [](float v)
-    {
-        auto v3 = melanolib::math::pow(v, 3);
-        return v3 > 0.008856 ? v3 : (v - 16.0 / 116) / 7.787;
-    };
-
-    from(repr::XYZ(conv(x) * ref.x, conv(y) * ref.y, conv(z) * ref.z));
+    detail::lab_to_xyz(value.l, value.a, value.b);
+    from(repr::XYZ(value.l, value.a, value.b));
 }
 
+template<>
+    inline constexpr repr::RGB Color::to<repr::RGB>() const
+{
+    return _rgb;
+}
 
 template<>
     inline constexpr repr::RGBf Color::to<repr::RGBf>() const
@@ -437,7 +597,7 @@ template<>
     {
 
         if ( cmax == rgbf.r )
-            h = rgbf.g - rgbf.b / delta;
+            h = (rgbf.g - rgbf.b) / delta;
         else if ( cmax == rgbf.g )
             h = (rgbf.b - rgbf.r) / delta + 2;
         else // cmax == b
@@ -455,48 +615,46 @@ template<>
 }
 
 template<>
-    inline repr::XYZ Color::to<repr::XYZ>() const
+    inline constexpr repr::HSV Color::to<repr::HSV>() const
 {
-    auto rgbf = to<repr::RGBf>();
+    const detail::HSVTables& tables = detail::HSVTablesHolder<>::tables;
 
-    auto conv = [](float v)
-    {
-        return v > 0.04045 ? melanolib::math::pow((v + 0.055) / 1.055, 2.4) : v / 12.92;
-    };
+    int r = _rgb.r, g = _rgb.g, b = _rgb.b;
+    int cmax = melanolib::math::max(r, g, b);
+    int delta = cmax - melanolib::math::min(r, g, b);
 
-    rgbf.r = conv(rgbf.r) * 100;
-    rgbf.g = conv(rgbf.g) * 100;
-    rgbf.b = conv(rgbf.b) * 100;
+    // Hue in units of delta, 6 * delta being a full turn
+    int hue = cmax == r ? g - b + (g < b ? 6 * delta : 0)
+            : cmax == g ? b - r + 2 * delta
+            : r - g + 4 * delta;
 
-    return {
-        rgbf.r * 0.4124f + rgbf.g * 0.3576f + rgbf.b * 0.1805f,
-        rgbf.r * 0.2126f + rgbf.g * 0.7152f + rgbf.b * 0.0722f,
-        rgbf.r * 0.0193f + rgbf.g * 0.1192f + rgbf.b * 0.9505f
-    };
+    return repr::HSV(
+        uint16_t((uint64_t(hue) * tables.hue_reciprocal[delta] + 0x8000) >> 16),
+        uint8_t((delta * tables.saturation_reciprocal[cmax] + 0x8000) >> 16),
+        uint8_t(cmax)
+    );
 }
 
 template<>
-    inline repr::Lab Color::to<repr::Lab>() const
+    inline constexpr repr::XYZ Color::to<repr::XYZ>() const
 {
-    auto source = to<repr::XYZ>();
-
-    repr::XYZ ref{95.047, 100.000, 108.883};
-
-    auto conv = [](float v) -> float
-    {
-        return v > 0.008856 ? melanolib::math::pow(v, 1.0 / 3) : 7.787 * v + 16.0 / 116;
-    };
+    float x = kernel::srgb8_to_linear(_rgb.r);
+    float y = kernel::srgb8_to_linear(_rgb.g);
+    float z = kernel::srgb8_to_linear(_rgb.b);
+    detail::linear_rgb_to_xyz(x, y, z);
+    return {x, y, z};
+}
 
-    repr::XYZ relative{
-        conv(source.x / ref.x),
-        conv(source.y / ref.y),
-        conv(source.z / ref.z),
-    };
-    return {
-        (116 * relative.y) - 16,
-        500 * (relative.x - relative.y),
-        200 * (relative.y - relative.z)
-    };
+template<>
+    inline constexpr repr::Lab Color::to<repr::Lab>() const
+{
+    auto xyz = to<repr::XYZ>();
+    detail::xyz_to_relative(xyz.x, xyz.y, xyz.z);
+    xyz.x = kernel::lab_f(xyz.x);
+    xyz.y = kernel::lab_f(xyz.y);
+    xyz.z = kernel::lab_f(xyz.z);
+    detail::lab_from_f(xyz.x, xyz.y, xyz.z);
+    return {xyz.x, xyz.y, xyz.z};
 }
 
 template<>
@@ -549,21 +707,156 @@ template<>
 }
 
 
+/**
+ * \brief Squared CIE76 Delta-E, for comparisons without a square root
+ */
+constexpr float delta_e_squared(const repr::Lab& a, const repr::Lab& b)
+{
+    return (a.l - b.l) * (a.l - b.l) +
+           (a.a - b.a) * (a.a - b.a) +
+           (a.b - b.b) * (a.b - b.b);
+}
+
 /**
  * \brief CIE76 Delta-E distance between two Lab colors
  */
 inline float delta_e(const repr::Lab& a, const repr::Lab& b)
 {
-    return melanolib::math::sqrt(
-        melanolib::math::pow(a.l - b.l, 2) +
-        melanolib::math::pow(a.a - b.a, 2) +
-        melanolib::math::pow(a.b - b.b, 2)
-    );
+    return melanolib::math::sqrt(delta_e_squared(a, b));
+}
+
+/**
+ * \brief Squared CIE94 Delta-E, with graphic arts weights
+ *
+ * Not symmetric, chroma and hue weights depend on \p reference.
+ */
+inline float delta_e94_squared(const repr::Lab& reference, const repr::Lab& sample)
+{
+    float chroma_reference = std::sqrt(reference.a * reference.a + reference.b * reference.b);
+    float delta_l = reference.l - sample.l;
+    float delta_c = chroma_reference - std::sqrt(sample.a * sample.a + sample.b * sample.b);
+    float delta_h2 = (reference.a - sample.a) * (reference.a - sample.a) +
+                     (reference.b - sample.b) * (reference.b - sample.b) -
+                     delta_c * delta_c;
+    float s_c = 1 + 0.045f * chroma_reference;
+    float s_h = 1 + 0.015f * chroma_reference;
+    return delta_l * delta_l +
+           delta_c * delta_c / (s_c * s_c) +
+           melanolib::math::max(delta_h2, 0.f) / (s_h * s_h);
+}
+
+/**
+ * \brief CIE94 Delta-E distance from \p reference to \p sample
+ */
+inline float delta_e94(const repr::Lab& reference, const repr::Lab& sample)
+{
+    return melanolib::math::sqrt(delta_e94_squared(reference, sample));
+}
+
+/**
+ * \brief Squared CIEDE2000 Delta-E, with unit weighting factors
+ */
+inline float delta_e2000_squared(const repr::Lab& a, const repr::Lab& b)
+{
+    constexpr float pi = 3.14159265358979f;
+    constexpr float degrees = pi / 180;
+    // 25^7, which makes the chroma corrections fade out at high chroma
+    constexpr float chroma_weight = 6103515625.f;
+    auto pow7 = [](float x) {
+        float x2 = x * x;
+        return x2 * x2 * x2 * x;
+    };
+
+    float chroma_mean = (std::sqrt(a.a * a.a + a.b * a.b) + std::sqrt(b.a * b.a + b.b * b.b)) / 2;
+    float chroma_mean7 = pow7(chroma_mean);
+    float g = 0.5f * (1 - std::sqrt(chroma_mean7 / (chroma_mean7 + chroma_weight)));
+    float a1 = (1 + g) * a.a;
+    float a2 = (1 + g) * b.a;
+    float c1 = std::sqrt(a1 * a1 + a.b * a.b);
+    float c2 = std::sqrt(a2 * a2 + b.b * b.b);
+    float h1 = c1 == 0 ? 0 : std::atan2(a.b, a1);
+    float h2 = c2 == 0 ? 0 : std::atan2(b.b, a2);
+    if ( h1 < 0 ) h1 += 2 * pi;
+    if ( h2 < 0 ) h2 += 2 * pi;
+
+    float delta_l = b.l - a.l;
+    float delta_c = c2 - c1;
+    float delta_h = 0;
+    float hue_mean = h1 + h2;
+    if ( c1 * c2 != 0 )
+    {
+        delta_h = h2 - h1;
+        if ( delta_h > pi )
+            delta_h -= 2 * pi;
+        else if ( delta_h < -pi )
+            delta_h += 2 * pi;
+
+        if ( std::abs(h1 - h2) <= pi )
+            hue_mean /= 2;
+        else if ( hue_mean < 2 * pi )
+            hue_mean = (hue_mean + 2 * pi) / 2;
+        else
+            hue_mean = (hue_mean - 2 * pi) / 2;
+    }
+    float delta_hue = 2 * std::sqrt(c1 * c2) * std::sin(delta_h / 2);
+
+    float l_mean = (a.l + b.l) / 2 - 50;
+    float c_mean = (c1 + c2) / 2;
+    float c_mean7 = pow7(c_mean);
+    float t = 1 - 0.17f * std::cos(hue_mean - 30 * degrees)
+                + 0.24f * std::cos(2 * hue_mean)
+                + 0.32f * std::cos(3 * hue_mean + 6 * degrees)
+                - 0.20f * std::cos(4 * hue_mean - 63 * degrees);
+    float hue_blue = (hue_mean / degrees - 275) / 25;
+    float rotation = 30 * degrees * std::exp(-hue_blue * hue_blue);
+    float r_c = 2 * std::sqrt(c_mean7 / (c_mean7 + chroma_weight));
+    float s_l = 1 + 0.015f * l_mean * l_mean / std::sqrt(20 + l_mean * l_mean);
+    float s_c = 1 + 0.045f * c_mean;
+    float s_h = 1 + 0.015f * c_mean * t;
+    float r_t = -std::sin(2 * rotation) * r_c;
+
+    float l = delta_l / s_l;
+    float c = delta_c / s_c;
+    float h = delta_hue / s_h;
+    return melanolib::math::max(l * l + c * c + h * h + r_t * c * h, 0.f);
+}
+
+/**
+ * \brief CIEDE2000 Delta-E distance between two Lab colors
+ */
+inline float delta_e2000(const repr::Lab& a, const repr::Lab& b)
+{
+    return melanolib::math::sqrt(delta_e2000_squared(a, b));
+}
+
+/**
+ * \brief Squared Delta-E between two Lab colors computed with \p metric
+ */
+inline float delta_e_squared(const repr::Lab& a, const repr::Lab& b, DeltaE metric)
+{
+    switch ( metric )
+    {
+        case DeltaE::CIE94:
+            return delta_e94_squared(a, b);
+        case DeltaE::CIEDE2000:
+            return delta_e2000_squared(a, b);
+        case DeltaE::CIE76:
+            break;
+    }
+    return delta_e_squared(a, b);
+}
+
+/**
+ * \brief Delta-E between two Lab colors computed with \p metric
+ */
+inline float delta_e(const repr::Lab& a, const repr::Lab& b, DeltaE metric)
+{
+    return melanolib::math::sqrt(delta_e_squared(a, b, metric));
 }
 
-inline float Color::distance(const Color& oth) const
+inline float Color::distance(const Color& oth, DeltaE metric) const
 {
-    return delta_e(to<repr::Lab>(), oth.to<repr::Lab>());
+    return delta_e(to<repr::Lab>(), oth.to<repr::Lab>(), metric);
 }
 
 } // namespace color
@@ -0,0 +1,233 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_CONSTEXPR_MATH_HPP
+#define ASCEDIT_COLOR_CONSTEXPR_MATH_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__has_builtin)
+#   if __has_builtin(__builtin_is_constant_evaluated)
+#       define ASCEDIT_HAS_IS_CONSTANT_EVALUATED
+#   endif
+#elif defined(__GNUC__) && __GNUC__ >= 9
+#   define ASCEDIT_HAS_IS_CONSTANT_EVALUATED
+#endif
+
+namespace color {
+
+/**
+ * \brief Math functions that can be evaluated at compile time
+ *
+ * These are meant to build tables, they are accurate to about 1e-15
+ * but much slower than the standard library at run time.
+ */
+namespace cx {
+
+constexpr double ln2 = 0.693147180559945309417232121458176568;
+
+/**
+ * \brief Natural logarithm
+ * \pre x > 0
+ */
+constexpr double log(double x)
+{
+    int exponent = 0;
+    while ( x >= 2 )
+    {
+        x /= 2;
+        exponent++;
+    }
+    while ( x < 1 )
+    {
+        x *= 2;
+        exponent--;
+    }
+
+    // log(x) = 2 atanh((x-1)/(x+1)), the argument is in [0, 1/3)
+    double y = (x - 1) / (x + 1);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0;
+    for ( int i = 1; i < 64; i += 2 )
+    {
+        sum += term / i;
+        term *= y2;
+    }
+    return 2 * sum + exponent * ln2;
+}
+
+/**
+ * \brief Exponential function
+ */
+constexpr double exp(double x)
+{
+    int exponent = int(x / ln2 + (x < 0 ? -0.5 : 0.5));
+    double r = x - exponent * ln2;
+
+    double term = 1;
+    double sum = 1;
+    for ( int i = 1; i < 24; i++ )
+    {
+        term *= r / i;
+        sum += term;
+    }
+
+    for ( ; exponent > 0; exponent-- )
+        sum *= 2;
+    for ( ; exponent < 0; exponent++ )
+        sum /= 2;
+    return sum;
+}
+
+/**
+ * \brief Raises \p base to a real exponent
+ * \pre base >= 0
+ */
+constexpr double pow(double base, double exponent)
+{
+    return base == 0 ? 0 : exp(exponent * log(base));
+}
+
+/**
+ * \brief Whether the call is part of a constant expression
+ *
+ * The functions below use it to pick the standard library at run time.
+ * Without compiler support it is always true, so the slower constexpr
+ * code is used at run time as well.
+ */
+constexpr bool is_constant_evaluated()
+{
+#ifdef ASCEDIT_HAS_IS_CONSTANT_EVALUATED
+    return __builtin_is_constant_evaluated();
+#else
+    return true;
+#endif
+}
+
+/**
+ * \brief Bit pattern of a float
+ * \pre v >= 0 and finite
+ */
+constexpr int32_t float_bits(float v)
+{
+    if ( !is_constant_evaluated() )
+    {
+        int32_t bits = 0;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+
+    // Scaling by powers of 2 is exact, denormals have the minimum exponent
+    double mantissa = v;
+    int exponent = 0;
+    while ( mantissa >= 2 )
+    {
+        mantissa /= 2;
+        exponent++;
+    }
+    while ( mantissa < 1 && exponent > -126 && mantissa > 0 )
+    {
+        mantissa *= 2;
+        exponent--;
+    }
+    if ( mantissa < 1 )
+        return int32_t(mantissa * (1 << 23));
+    return int32_t((exponent + 127) << 23) | int32_t((mantissa - 1) * (1 << 23));
+}
+
+/**
+ * \brief Float with the given bit pattern
+ * \pre bits is a positive finite float
+ */
+constexpr float bits_float(int32_t bits)
+{
+    if ( !is_constant_evaluated() )
+    {
+        float v = 0;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    int biased = (bits >> 23) & 0xff;
+    double value = double(bits & 0x7fffff) / (1 << 23);
+    int exponent = -126;
+    if ( biased )
+    {
+        value += 1;
+        exponent = biased - 127;
+    }
+    for ( ; exponent > 0; exponent-- )
+        value *= 2;
+    for ( ; exponent < 0; exponent++ )
+        value /= 2;
+    return value;
+}
+
+/**
+ * \brief Square root, correctly rounded like std::sqrt()
+ * \pre v >= 0 and finite
+ */
+constexpr float sqrt(float v)
+{
+    if ( !is_constant_evaluated() )
+        return std::sqrt(v);
+
+    if ( v <= 0 )
+        return 0;
+
+    // Newton's method from above decreases until it settles
+    double x = v;
+    double guess = x > 1 ? x : 1;
+    while ( true )
+    {
+        double next = (guess + x / guess) / 2;
+        if ( next >= guess )
+            break;
+        guess = next;
+    }
+
+    // Midpoints between floats have 25 significant bits so their squares
+    // are exact in double precision and never equal to x
+    float result = guess;
+    while ( true )
+    {
+        float up = bits_float(float_bits(result) + 1);
+        double middle = (double(result) + up) / 2;
+        if ( middle * middle >= x )
+            break;
+        result = up;
+    }
+    while ( result > 0 )
+    {
+        float down = bits_float(float_bits(result) - 1);
+        double middle = (double(result) + down) / 2;
+        if ( middle * middle <= x )
+            break;
+        result = down;
+    }
+    return result;
+}
+
+} // namespace cx
+} // namespace color
+#endif // ASCEDIT_COLOR_CONSTEXPR_MATH_HPP
@@ -22,6 +22,8 @@
 
 #include "cute_color.hpp"
 
+#include <cstring>
+
 namespace color {
 
 Color from_qt(QColor color)
@@ -44,4 +46,149 @@ Color from_qt(QColor color)
     }
 }
 
+bool is_direct_format(QImage::Format format)
+{
+    return format == QImage::Format_RGB32 ||
+           format == QImage::Format_ARGB32 ||
+           format == QImage::Format_RGB888;
+}
+
+void from_qimage_row(const QImage& image, int y, Color* output)
+{
+    const uchar* line = image.constScanLine(y);
+    int width = image.width();
+
+    if ( image.format() == QImage::Format_RGB888 )
+    {
+        for ( int x = 0; x < width; x++, line += 3 )
+            output[x] = Color(line[0], line[1], line[2]);
+        return;
+    }
+
+    // Format_RGB32 has the alpha bits set to 0xff
+    const QRgb* pixels = reinterpret_cast<const QRgb*>(line);
+    for ( int x = 0; x < width; x++ )
+    {
+        QRgb pixel = pixels[x];
+        output[x] = Color(qRed(pixel), qGreen(pixel), qBlue(pixel), qAlpha(pixel));
+    }
+}
+
+void from_qimage_row(const QImage& image, int y, PackedColor* output)
+{
+    const uchar* line = image.constScanLine(y);
+    int width = image.width();
+
+    if ( image.format() == QImage::Format_RGB888 )
+    {
+        for ( int x = 0; x < width; x++, line += 3 )
+            output[x] = PackedColor(line[0], line[1], line[2]);
+        return;
+    }
+
+    const QRgb* pixels = reinterpret_cast<const QRgb*>(line);
+    for ( int x = 0; x < width; x++ )
+        output[x] = PackedColor::from_argb(pixels[x]);
+}
+
+/**
+ * \brief Reads all the rows of \p image, converted to a supported format if needed
+ */
+template<class ColorType>
+    static std::vector<ColorType> read_image(const QImage& image)
+{
+    if ( !is_direct_format(image.format()) )
+        return read_image<ColorType>(image.convertToFormat(QImage::Format_ARGB32));
+
+    std::size_t width = image.width();
+    std::vector<ColorType> colors(width * image.height());
+    for ( int y = 0; y < image.height(); y++ )
+        from_qimage_row(image, y, colors.data() + y * width);
+    return colors;
+}
+
+std::vector<Color> from_qimage(const QImage& image)
+{
+    return read_image<Color>(image);
+}
+
+std::vector<PackedColor> from_qimage_packed(const QImage& image)
+{
+    return read_image<PackedColor>(image);
+}
+
+void to_qimage_row(const Color* input, QImage& image, int y)
+{
+    uchar* line = image.scanLine(y);
+    int width = image.width();
+
+    if ( image.format() == QImage::Format_RGB888 )
+    {
+        for ( int x = 0; x < width; x++, line += 3 )
+        {
+            line[0] = input[x].red();
+            line[1] = input[x].green();
+            line[2] = input[x].blue();
+        }
+        return;
+    }
+
+    QRgb* pixels = reinterpret_cast<QRgb*>(line);
+    if ( image.format() == QImage::Format_RGB32 )
+    {
+        for ( int x = 0; x < width; x++ )
+            pixels[x] = to_qrgb(input[x]) | 0xff000000;
+        return;
+    }
+
+    for ( int x = 0; x < width; x++ )
+        pixels[x] = to_qrgb(input[x]);
+}
+
+void to_qimage_row(const PackedColor* input, QImage& image, int y)
+{
+    uchar* line = image.scanLine(y);
+    int width = image.width();
+
+    if ( image.format() == QImage::Format_RGB888 )
+    {
+        for ( int x = 0; x < width; x++, line += 3 )
+        {
+            line[0] = input[x].red();
+            line[1] = input[x].green();
+            line[2] = input[x].blue();
+        }
+        return;
+    }
+
+    if ( image.format() == QImage::Format_ARGB32 )
+    {
+        std::memcpy(line, input, width * sizeof(PackedColor));
+        return;
+    }
+
+    QRgb* pixels = reinterpret_cast<QRgb*>(line);
+    for ( int x = 0; x < width; x++ )
+        pixels[x] = input[x].argb() | 0xff000000;
+}
+
+template<class ColorType>
+    static QImage write_image(const ColorType* input, QSize size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    for ( int y = 0; y < size.height(); y++ )
+        to_qimage_row(input + y * std::size_t(size.width()), image, y);
+    return image;
+}
+
+QImage to_qimage(const Color* input, QSize size)
+{
+    return write_image(input, size);
+}
+
+QImage to_qimage(const PackedColor* input, QSize size)
+{
+    return write_image(input, size);
+}
+
 } // namespace color
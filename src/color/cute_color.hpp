@@ -21,9 +21,13 @@
 #ifndef ASCEDIT_COLOR_CUTECOLOR_HPP
 #define ASCEDIT_COLOR_CUTECOLOR_HPP
 
+#include <vector>
+
 #include <QColor>
+#include <QImage>
 
 #include "color.hpp"
+#include "packed_color.hpp"
 
 namespace color {
 
@@ -41,5 +45,68 @@ inline QRgb to_qrgb(Color color)
     return qRgba(color.red(), color.green(), color.blue(), color.alpha());
 }
 
+/**
+ * \brief Whether from_qimage_row() and to_qimage_row() support \p format
+ *
+ * These are QImage::Format_RGB32, QImage::Format_ARGB32 and
+ * QImage::Format_RGB888.
+ */
+bool is_direct_format(QImage::Format format);
+
+/**
+ * \brief Reads row \p y of \p image straight from its scanline
+ * \param output Buffer with room for image.width() colors
+ * \pre is_direct_format(image.format())
+ */
+void from_qimage_row(const QImage& image, int y, Color* output);
+
+/**
+ * \brief Reads row \p y of \p image into packed colors
+ *
+ * For QImage::Format_ARGB32 this is a copy of the scanline.
+ * \param output Buffer with room for image.width() colors
+ * \pre is_direct_format(image.format())
+ */
+void from_qimage_row(const QImage& image, int y, PackedColor* output);
+
+/**
+ * \brief Colors of all the pixels of \p image in row order
+ *
+ * Images in formats not supported by from_qimage_row() are converted
+ * to QImage::Format_ARGB32 first.
+ */
+std::vector<Color> from_qimage(const QImage& image);
+
+/**
+ * \brief Packed colors of all the pixels of \p image in row order
+ * \see from_qimage()
+ */
+std::vector<PackedColor> from_qimage_packed(const QImage& image);
+
+/**
+ * \brief Writes \p input to row \p y of \p image, as to_qrgb() would
+ * \param input image.width() colors
+ * \pre is_direct_format(image.format())
+ * \note Alpha is dropped in formats without an alpha channel
+ */
+void to_qimage_row(const Color* input, QImage& image, int y);
+
+/**
+ * \brief Writes packed colors to row \p y of \p image
+ *
+ * For QImage::Format_ARGB32 this is a copy of the scanline.
+ * \param input image.width() colors
+ * \pre is_direct_format(image.format())
+ */
+void to_qimage_row(const PackedColor* input, QImage& image, int y);
+
+/**
+ * \brief QImage::Format_ARGB32 image of \p size from colors in row order
+ * \param input size.width() * size.height() colors
+ */
+QImage to_qimage(const Color* input, QSize size);
+
+QImage to_qimage(const PackedColor* input, QSize size);
+
 } // namespace color
 #endif // ASCEDIT_COLOR_CUTECOLOR_HPP
@@ -0,0 +1,199 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define ASCEDIT_KERNELS_X86
+#   include <immintrin.h>
+#endif
+
+namespace color {
+namespace kernel {
+
+namespace {
+
+/**
+ * \brief Set of array functions for one instruction set
+ */
+struct KernelSet
+{
+    const char* name;
+    void (*linear_to_srgb)(float*, std::size_t);
+    void (*lab_f)(float*, std::size_t);
+};
+
+void linear_to_srgb_scalar(float* values, std::size_t count)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+        values[i] = linear_to_srgb(values[i]);
+}
+
+void lab_f_scalar(float* values, std::size_t count)
+{
+    for ( std::size_t i = 0; i < count; i++ )
+        values[i] = lab_f(values[i]);
+}
+
+#ifdef ASCEDIT_KERNELS_X86
+
+// The vector code mirrors the scalar functions in kernels.hpp operation by
+// operation, lanes failing the threshold test are computed anyway and then
+// masked out.
+
+__attribute__((target("sse2")))
+__m128 cbrt_sse2(__m128 v)
+{
+    const __m128 third = _mm_set1_ps(detail::third);
+    __m128i bits = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(v)), third));
+    __m128 guess = _mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(709921077)));
+    for ( int i = 0; i < 3; i++ )
+    {
+        __m128 quotient = _mm_div_ps(v, _mm_mul_ps(guess, guess));
+        guess = _mm_mul_ps(_mm_add_ps(_mm_add_ps(guess, guess), quotient), third);
+    }
+    return guess;
+}
+
+__attribute__((target("sse2")))
+__m128 select_sse2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+void linear_to_srgb_sse2(float* values, std::size_t count)
+{
+    std::size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        __m128 root = cbrt_sse2(v);
+        __m128 power = _mm_mul_ps(root, _mm_sqrt_ps(_mm_sqrt_ps(root)));
+        __m128 high = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.055f), power), _mm_set1_ps(0.055f));
+        __m128 low = _mm_mul_ps(_mm_set1_ps(12.92f), v);
+        __m128 mask = _mm_cmpgt_ps(v, _mm_set1_ps(0.0031308f));
+        _mm_storeu_ps(values + i, select_sse2(mask, high, low));
+    }
+    linear_to_srgb_scalar(values + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void lab_f_sse2(float* values, std::size_t count)
+{
+    std::size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        __m128 high = cbrt_sse2(v);
+        __m128 low = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(7.787f), v), _mm_set1_ps(16.0f / 116));
+        __m128 mask = _mm_cmpgt_ps(v, _mm_set1_ps(0.008856f));
+        _mm_storeu_ps(values + i, select_sse2(mask, high, low));
+    }
+    lab_f_scalar(values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+__m256 cbrt_avx2(__m256 v)
+{
+    const __m256 third = _mm256_set1_ps(detail::third);
+    __m256i bits = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(v)), third));
+    __m256 guess = _mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(709921077)));
+    for ( int i = 0; i < 3; i++ )
+    {
+        __m256 quotient = _mm256_div_ps(v, _mm256_mul_ps(guess, guess));
+        guess = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(guess, guess), quotient), third);
+    }
+    return guess;
+}
+
+__attribute__((target("avx2")))
+void linear_to_srgb_avx2(float* values, std::size_t count)
+{
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256 v = _mm256_loadu_ps(values + i);
+        __m256 root = cbrt_avx2(v);
+        __m256 power = _mm256_mul_ps(root, _mm256_sqrt_ps(_mm256_sqrt_ps(root)));
+        __m256 high = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.055f), power), _mm256_set1_ps(0.055f));
+        __m256 low = _mm256_mul_ps(_mm256_set1_ps(12.92f), v);
+        __m256 mask = _mm256_cmp_ps(v, _mm256_set1_ps(0.0031308f), _CMP_GT_OQ);
+        _mm256_storeu_ps(values + i, _mm256_blendv_ps(low, high, mask));
+    }
+    linear_to_srgb_sse2(values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void lab_f_avx2(float* values, std::size_t count)
+{
+    std::size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256 v = _mm256_loadu_ps(values + i);
+        __m256 high = cbrt_avx2(v);
+        __m256 low = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(7.787f), v), _mm256_set1_ps(16.0f / 116));
+        __m256 mask = _mm256_cmp_ps(v, _mm256_set1_ps(0.008856f), _CMP_GT_OQ);
+        _mm256_storeu_ps(values + i, _mm256_blendv_ps(low, high, mask));
+    }
+    lab_f_sse2(values + i, count - i);
+}
+
+#endif // ASCEDIT_KERNELS_X86
+
+KernelSet select_kernels()
+{
+#ifdef ASCEDIT_KERNELS_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") )
+        return {"avx2", linear_to_srgb_avx2, lab_f_avx2};
+    if ( __builtin_cpu_supports("sse2") )
+        return {"sse2", linear_to_srgb_sse2, lab_f_sse2};
+#endif
+    return {"scalar", linear_to_srgb_scalar, lab_f_scalar};
+}
+
+const KernelSet& kernels()
+{
+    static const KernelSet selected = select_kernels();
+    return selected;
+}
+
+} // namespace
+
+void linear_to_srgb(float* values, std::size_t count)
+{
+    kernels().linear_to_srgb(values, count);
+}
+
+void lab_f(float* values, std::size_t count)
+{
+    kernels().lab_f(values, count);
+}
+
+const char* instruction_set()
+{
+    return kernels().name;
+}
+
+} // namespace kernel
+} // namespace color
@@ -0,0 +1,159 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_KERNELS_HPP
+#define ASCEDIT_COLOR_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "constexpr_math.hpp"
+
+namespace color {
+
+/**
+ * \brief Transfer functions used by the color space conversions
+ *
+ * The scalar functions and the array functions perform the same sequence
+ * of floating point operations, so they give identical results whichever
+ * instruction set the array functions end up using.
+ * The scalar functions can also be evaluated at compile time, with the
+ * same results.
+ */
+namespace kernel {
+
+namespace detail {
+
+/**
+ * \brief Table mapping 8 bit sRGB channels to linear-light values in [0, 100]
+ */
+struct SrgbLinearTable
+{
+    float values[256];
+
+    constexpr SrgbLinearTable()
+        : values{}
+    {
+        for ( int i = 0; i < 256; i++ )
+        {
+            double v = i / 255.0;
+            values[i] = (v > 0.04045 ? cx::pow((v + 0.055) / 1.055, 2.4) : v / 12.92) * 100;
+        }
+    }
+};
+
+template<class = void>
+    struct Tables
+{
+    static constexpr SrgbLinearTable srgb_linear{};
+};
+
+template<class T>
+    constexpr SrgbLinearTable Tables<T>::srgb_linear;
+
+constexpr float third = 1.0f / 3;
+
+/**
+ * \brief Initial estimate for cbrt(), obtained by dividing the exponent by 3
+ */
+constexpr float cbrt_estimate(float v)
+{
+    int32_t bits = cx::float_bits(v);
+    bits = int32_t(float(bits) * third) + 709921077;
+    return cx::bits_float(bits);
+}
+
+/**
+ * \brief Newton-Raphson step for the cube root of \p v
+ */
+constexpr float cbrt_step(float guess, float v)
+{
+    float square = guess * guess;
+    float quotient = v / square;
+    float sum = guess + guess;
+    sum = sum + quotient;
+    return sum * third;
+}
+
+} // namespace detail
+
+/**
+ * \brief sRGB companding of an 8 bit channel to linear-light in [0, 100]
+ */
+constexpr float srgb8_to_linear(uint8_t v)
+{
+    return detail::Tables<>::srgb_linear.values[v];
+}
+
+/**
+ * \brief Cube root of a positive number
+ */
+constexpr float cbrt(float v)
+{
+    float guess = detail::cbrt_estimate(v);
+    guess = detail::cbrt_step(guess, v);
+    guess = detail::cbrt_step(guess, v);
+    return detail::cbrt_step(guess, v);
+}
+
+/**
+ * \brief Linear-light in [0, 1] to sRGB in [0, 1]
+ *
+ * Computes v^(1/2.4) as c * c^(1/4) with c = cbrt(v).
+ */
+constexpr float linear_to_srgb(float v)
+{
+    if ( v > 0.0031308f )
+    {
+        float root = cbrt(v);
+        float power = root * cx::sqrt(cx::sqrt(root));
+        return 1.055f * power - 0.055f;
+    }
+    return 12.92f * v;
+}
+
+/**
+ * \brief Companding function used by the XYZ to Lab conversion
+ */
+constexpr float lab_f(float v)
+{
+    if ( v > 0.008856f )
+        return cbrt(v);
+    return 7.787f * v + 16.0f / 116;
+}
+
+/**
+ * \brief Applies linear_to_srgb() to \p count values in place
+ */
+void linear_to_srgb(float* values, std::size_t count);
+
+/**
+ * \brief Applies lab_f() to \p count values in place
+ */
+void lab_f(float* values, std::size_t count);
+
+/**
+ * \brief Name of the instruction set used by the array functions
+ */
+const char* instruction_set();
+
+} // namespace kernel
+} // namespace color
+#endif // ASCEDIT_COLOR_KERNELS_HPP
@@ -0,0 +1,174 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_PACKED_COLOR_HPP
+#define ASCEDIT_COLOR_PACKED_COLOR_HPP
+
+#include <type_traits>
+
+#include "color.hpp"
+
+namespace color {
+
+/**
+ * \brief Value of PackedColor representing invalid colors
+ */
+constexpr uint32_t invalid_argb = 0x00ff00ff;
+
+/**
+ * \brief Color stored in 32 bits with the same layout as QRgb
+ *
+ * The value is 0xAARRGGBB in native byte order, like the pixels of
+ * QImage::Format_ARGB32, so arrays can be copied to and from image
+ * scanlines or loaded in vector registers as they are.
+ *
+ * Invalid colors are stored as invalid_argb, a fully transparent value.
+ * Valid colors which would have that value are stored with the blue
+ * channel changed by one, which isn't visible as they are transparent.
+ *
+ * It converts to and from Color like the types in color::repr, the alpha
+ * passed to the Color constructor is ignored in favour of the packed one.
+ */
+class PackedColor
+{
+public:
+    /**
+     * \brief Invalid color
+     */
+    constexpr PackedColor()
+        : _argb(invalid_argb)
+    {}
+
+    constexpr PackedColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
+        : _argb(valid_argb((uint32_t(a) << 24) | (r << 16) | (g << 8) | b))
+    {}
+
+    /**
+     * \brief Packed color from a QRgb value, always valid
+     */
+    static constexpr PackedColor from_argb(uint32_t argb)
+    {
+        return PackedColor(valid_argb(argb), 0);
+    }
+
+    /**
+     * \brief QRgb value, invalid colors are transparent
+     */
+    constexpr uint32_t argb() const
+    {
+        return _argb;
+    }
+
+    constexpr bool valid() const
+    {
+        return _argb != invalid_argb;
+    }
+
+    constexpr uint8_t alpha() const
+    {
+        return _argb >> 24;
+    }
+
+    constexpr uint8_t red() const
+    {
+        return _argb >> 16;
+    }
+
+    constexpr uint8_t green() const
+    {
+        return _argb >> 8;
+    }
+
+    constexpr uint8_t blue() const
+    {
+        return _argb;
+    }
+
+    constexpr bool operator==(const PackedColor& oth) const
+    {
+        return _argb == oth._argb;
+    }
+
+    constexpr bool operator!=(const PackedColor& oth) const
+    {
+        return _argb != oth._argb;
+    }
+
+    /**
+     * \brief Moves valid colors away from invalid_argb
+     */
+    static constexpr uint32_t valid_argb(uint32_t argb)
+    {
+        return argb == invalid_argb ? argb ^ 1 : argb;
+    }
+
+private:
+    constexpr PackedColor(uint32_t argb, int)
+        : _argb(argb)
+    {}
+
+    uint32_t _argb;
+};
+
+static_assert(sizeof(PackedColor) == sizeof(uint32_t), "PackedColor must be 32 bits");
+static_assert(alignof(PackedColor) == alignof(uint32_t), "PackedColor must be aligned as uint32_t");
+static_assert(std::is_trivially_copyable<PackedColor>::value, "PackedColor must be copyable with memcpy");
+static_assert(std::is_standard_layout<PackedColor>::value, "PackedColor must be standard layout");
+
+template<>
+    inline constexpr void Color::from<PackedColor>(PackedColor value)
+{
+    _rgb = repr::RGB(value.red(), value.green(), value.blue());
+    _alpha = value.alpha();
+    _valid = value.valid();
+    if ( !_valid )
+        _rgb = repr::RGB();
+}
+
+template<>
+    inline constexpr PackedColor Color::to<PackedColor>() const
+{
+    if ( !_valid )
+        return PackedColor();
+    return PackedColor(_rgb.r, _rgb.g, _rgb.b, _alpha);
+}
+
+/**
+ * \brief Packs the colors in [begin, end)
+ * \param output Buffer with room for end - begin elements
+ */
+inline void pack(const Color* begin, const Color* end, PackedColor* output)
+{
+    for ( ; begin < end; ++begin, ++output )
+        *output = begin->to<PackedColor>();
+}
+
+/**
+ * \brief Unpacks the colors in [begin, end)
+ * \param output Buffer with room for end - begin elements
+ */
+inline void unpack(const PackedColor* begin, const PackedColor* end, Color* output)
+{
+    for ( ; begin < end; ++begin, ++output )
+        *output = Color(*begin);
+}
+
+} // namespace color
+#endif // ASCEDIT_COLOR_PACKED_COLOR_HPP
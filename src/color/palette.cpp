@@ -0,0 +1,308 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "palette.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "batch.hpp"
+
+namespace color {
+
+constexpr std::size_t Palette::npos;
+constexpr std::size_t Palette::Cache::max_palette_size;
+constexpr float Palette::Bound::margin;
+
+Palette::Palette(DeltaE metric)
+    : _metric(metric), _cache(new Cache)
+{
+}
+
+Palette::Palette(std::vector<Color> colors, DeltaE metric)
+    : _colors(std::move(colors)), _metric(metric), _cache(new Cache)
+{
+    build();
+}
+
+Palette::Palette(const Palette& oth)
+    : _colors(oth._colors), _lab(oth._lab), _tree(oth._tree), _metric(oth._metric),
+      _min_l(oth._min_l), _max_l(oth._max_l),
+      _cache(new Cache)
+{
+}
+
+Palette& Palette::operator=(const Palette& oth)
+{
+    if ( this != &oth )
+    {
+        _colors = oth._colors;
+        _lab = oth._lab;
+        _tree = oth._tree;
+        _metric = oth._metric;
+        _min_l = oth._min_l;
+        _max_l = oth._max_l;
+        _cache.reset(new Cache);
+    }
+    return *this;
+}
+
+void Palette::build()
+{
+    _lab.assign(_colors.size(), repr::Lab(0, 0, 0));
+    convert(_colors.data(), _colors.data() + _colors.size(), _lab.data());
+    build_index();
+}
+
+void Palette::build_index()
+{
+    _tree.clear();
+    _tree.reserve(_colors.size());
+    _min_l = _max_l = _lab.empty() ? 0 : _lab[0].l;
+    for ( std::size_t i = 0; i < _colors.size(); i++ )
+    {
+        float chroma = std::sqrt(_lab[i].a * _lab[i].a + _lab[i].b * _lab[i].b);
+        _tree.push_back(Node{{_lab[i].l, _lab[i].a, _lab[i].b}, chroma, chroma, uint32_t(i), 0});
+        _min_l = std::min(_min_l, _lab[i].l);
+        _max_l = std::max(_max_l, _lab[i].l);
+    }
+    build_tree(0, _tree.size());
+}
+
+void Palette::build_tree(std::size_t begin, std::size_t end)
+{
+    if ( end - begin < 2 )
+        return;
+
+    // Split along the axis with the largest spread
+    float min[3], max[3];
+    for ( int axis = 0; axis < 3; axis++ )
+        min[axis] = max[axis] = _tree[begin].lab[axis];
+    for ( std::size_t i = begin + 1; i < end; i++ )
+    {
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            min[axis] = std::min(min[axis], _tree[i].lab[axis]);
+            max[axis] = std::max(max[axis], _tree[i].lab[axis]);
+        }
+    }
+    int axis = 0;
+    for ( int i = 1; i < 3; i++ )
+        if ( max[i] - min[i] > max[axis] - min[axis] )
+            axis = i;
+
+    std::size_t mid = begin + (end - begin) / 2;
+    std::nth_element(_tree.begin() + begin, _tree.begin() + mid, _tree.begin() + end,
+        [axis](const Node& a, const Node& b) {
+            return a.lab[axis] < b.lab[axis];
+        }
+    );
+    _tree[mid].axis = axis;
+
+    build_tree(begin, mid);
+    build_tree(mid + 1, end);
+
+    for ( std::size_t child : {begin + (mid - begin) / 2, mid + 1 + (end - mid - 1) / 2} )
+        if ( child < end && child != mid )
+            _tree[mid].range_chroma = std::max(_tree[mid].range_chroma, _tree[child].range_chroma);
+}
+
+void Palette::search(const float* query, std::size_t begin, std::size_t end,
+                     std::size_t& best, float& best_distance) const
+{
+    if ( begin >= end )
+        return;
+
+    std::size_t mid = begin + (end - begin) / 2;
+    const Node& node = _tree[mid];
+
+    float distance = 0;
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        float delta = query[axis] - node.lab[axis];
+        distance += delta * delta;
+    }
+    if ( distance < best_distance || (distance == best_distance && node.index < best) )
+    {
+        best_distance = distance;
+        best = node.index;
+    }
+
+    float split = query[node.axis] - node.lab[node.axis];
+    if ( split < 0 )
+    {
+        search(query, begin, mid, best, best_distance);
+        if ( split * split <= best_distance )
+            search(query, mid + 1, end, best, best_distance);
+    }
+    else
+    {
+        search(query, mid + 1, end, best, best_distance);
+        if ( split * split <= best_distance )
+            search(query, begin, mid, best, best_distance);
+    }
+}
+
+Palette::Bound Palette::lower_bound(const repr::Lab& lab) const
+{
+    constexpr float margin = Bound::margin;
+    float chroma = std::sqrt(lab.a * lab.a + lab.b * lab.b);
+
+    if ( _metric == DeltaE::CIE94 )
+    {
+        // The chroma and hue terms add up to at least the a b distance over S_C
+        float s_c = 1 + 0.045f * chroma;
+        return Bound{{lab.l, lab.a, lab.b}, margin, false, margin, s_c, 0};
+    }
+
+    // CIEDE2000: S_L is largest at the lightness furthest from 50.
+    // S_H never exceeds S_C, which grows with the mean chroma, and the a'
+    // correction adds at most 6.375 to it. R_T removes at most sin(60)
+    // of the chroma and hue terms.
+    float l_far = std::max(std::abs((lab.l + _min_l) / 2 - 50), std::abs((lab.l + _max_l) / 2 - 50));
+    float s_l = 1 + 0.015f * l_far * l_far / std::sqrt(20 + l_far * l_far);
+    return Bound{
+        {lab.l, lab.a, lab.b},
+        margin / (s_l * s_l),
+        true,
+        margin * (1 - 0.8660254f),
+        1 + 0.045f * (6.375f + chroma / 2),
+        0.0225f
+    };
+}
+
+void Palette::search(const Bound& bound, std::size_t begin, std::size_t end,
+                     std::size_t& best, float& best_distance) const
+{
+    if ( begin >= end )
+        return;
+
+    std::size_t mid = begin + (end - begin) / 2;
+    const Node& node = _tree[mid];
+
+    float delta_l = bound.lab[0] - node.lab[0];
+    float delta_a = bound.lab[1] - node.lab[1];
+    float delta_b = bound.lab[2] - node.lab[2];
+    float delta_l2 = delta_l * delta_l;
+    float delta_ab2 = bound.ab_weight(node.chroma) * (delta_a * delta_a + delta_b * delta_b);
+    // The lightness weight is refined only for entries passing the coarser bound
+    if ( bound.l_weight * delta_l2 + delta_ab2 <= best_distance &&
+         bound.l_weight_at(node.lab[0]) * delta_l2 + delta_ab2 <= best_distance )
+    {
+        repr::Lab query(bound.lab[0], bound.lab[1], bound.lab[2]);
+        float distance = delta_e_squared(query, _lab[node.index], _metric);
+        if ( distance < best_distance || (distance == best_distance && node.index < best) )
+        {
+            best_distance = distance;
+            best = node.index;
+        }
+    }
+
+    // Entries past the split are at least this far along its axis
+    float split = bound.lab[node.axis] - node.lab[node.axis];
+    std::size_t near_begin = begin, near_end = mid, far_begin = mid + 1, far_end = end;
+    if ( split >= 0 )
+    {
+        std::swap(near_begin, far_begin);
+        std::swap(near_end, far_end);
+    }
+    search(bound, near_begin, near_end, best, best_distance);
+    if ( far_begin >= far_end )
+        return;
+
+    float weight = bound.l_weight;
+    if ( node.axis != 0 )
+        weight = bound.ab_weight(_tree[far_begin + (far_end - far_begin) / 2].range_chroma);
+    if ( weight * split * split <= best_distance )
+        search(bound, far_begin, far_end, best, best_distance);
+}
+
+std::size_t Palette::nearest(const repr::Lab& lab) const
+{
+    std::size_t best = npos;
+    float best_distance = std::numeric_limits<float>::infinity();
+    float query[3] = {lab.l, lab.a, lab.b};
+    search(query, 0, _tree.size(), best, best_distance);
+    if ( _metric == DeltaE::CIE76 || best == npos )
+        return best;
+
+    // The CIE76 match is usually close, so few entries pass the bound
+    best_distance = delta_e_squared(lab, _lab[best], _metric);
+    search(lower_bound(lab), 0, _tree.size(), best, best_distance);
+    return best;
+}
+
+std::atomic<uint16_t>* Palette::cache() const
+{
+    std::call_once(_cache->allocated, [this]{
+        _cache->entries.reset(new std::atomic<uint16_t>[1 << 24]());
+    });
+    return _cache->entries.get();
+}
+
+std::size_t Palette::nearest(const Color& color) const
+{
+    // Indices that don't fit the cache are looked up every time
+    if ( _colors.empty() || _colors.size() > Cache::max_palette_size )
+        return nearest(color.to<repr::Lab>());
+
+    std::atomic<uint16_t>& entry = cache()[color.to<repr::RGB_int24>().rgb];
+    // Racing threads compute and store the same value
+    uint16_t cached = entry.load(std::memory_order_relaxed);
+    if ( cached == 0 )
+    {
+        cached = nearest(color.to<repr::Lab>()) + 1;
+        entry.store(cached, std::memory_order_relaxed);
+    }
+    return cached - 1;
+}
+
+void Palette::nearest(const Color* begin, const Color* end, std::size_t* output) const
+{
+    std::transform(begin, end, output, [this](const Color& color) {
+        return nearest(color);
+    });
+}
+
+uint8_t xterm256_nearest(const Color& color, DeltaE metric)
+{
+    switch ( metric )
+    {
+        case DeltaE::CIE94:
+        {
+            static const Palette palette(xterm256_palette(), 16, DeltaE::CIE94);
+            return 16 + palette.nearest(color);
+        }
+        case DeltaE::CIEDE2000:
+        {
+            static const Palette palette(xterm256_palette(), 16, DeltaE::CIEDE2000);
+            return 16 + palette.nearest(color);
+        }
+        case DeltaE::CIE76:
+            break;
+    }
+    static const Palette palette(xterm256_palette(), 16);
+    return 16 + palette.nearest(color);
+}
+
+} // namespace color
@@ -0,0 +1,233 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_PALETTE_HPP
+#define ASCEDIT_COLOR_PALETTE_HPP
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "color.hpp"
+#include "terminal_palette.hpp"
+
+namespace color {
+
+/**
+ * \brief Fixed set of colors with fast nearest color lookup
+ *
+ * Lab values are computed once per entry and stored in a k-d tree.
+ * Distances use the DeltaE metric given on construction, CIE94 and
+ * CIEDE2000 searches only evaluate the full formula for entries which
+ * pass a cheap lower bound.
+ *
+ * Queries by Color are memoized in a table indexed by 24 bit RGB,
+ * which is allocated on the first such query (32 MiB) and can be
+ * shared between threads.
+ */
+class Palette
+{
+public:
+    /**
+     * \brief Value returned by nearest() when the palette is empty
+     */
+    static constexpr std::size_t npos = -1;
+
+    explicit Palette(DeltaE metric = DeltaE::CIE76);
+    explicit Palette(std::vector<Color> colors, DeltaE metric = DeltaE::CIE76);
+
+    /**
+     * \brief Builds the palette using the Lab values stored in \p table
+     * \param first Index of the first entry of \p table to use
+     */
+    template<std::size_t Size>
+        explicit Palette(const PaletteTable<Size>& table, std::size_t first = 0,
+                         DeltaE metric = DeltaE::CIE76)
+        : _colors(table.colors + first, table.colors + Size),
+          _lab(table.lab + first, table.lab + Size),
+          _metric(metric),
+          _cache(new Cache)
+    {
+        build_index();
+    }
+
+    Palette(const Palette& oth);
+    Palette(Palette&& oth) = default;
+    Palette& operator=(const Palette& oth);
+    Palette& operator=(Palette&& oth) = default;
+
+    const std::vector<Color>& colors() const
+    {
+        return _colors;
+    }
+
+    std::size_t size() const
+    {
+        return _colors.size();
+    }
+
+    bool empty() const
+    {
+        return _colors.empty();
+    }
+
+    DeltaE metric() const
+    {
+        return _metric;
+    }
+
+    const Color& operator[](std::size_t index) const
+    {
+        return _colors[index];
+    }
+
+    /**
+     * \brief Precomputed Lab value of the entry at \p index
+     */
+    const repr::Lab& lab(std::size_t index) const
+    {
+        return _lab[index];
+    }
+
+    /**
+     * \brief Index of the entry closest to \p color
+     *
+     * Alpha is ignored, distances are the same as
+     * color.distance(entry, metric()).
+     * \note This operation is only defined for valid colors
+     */
+    std::size_t nearest(const Color& color) const;
+
+    /**
+     * \brief Index of the entry closest to \p lab
+     *
+     * Unlike nearest(const Color&), the result is not memoized.
+     */
+    std::size_t nearest(const repr::Lab& lab) const;
+
+    /**
+     * \brief Writes the nearest index for each color in [begin, end)
+     * \param output Buffer with room for end - begin elements
+     */
+    void nearest(const Color* begin, const Color* end, std::size_t* output) const;
+
+    /**
+     * \brief Entry closest to \p color, or an invalid color if the palette is empty
+     */
+    Color nearest_color(const Color& color) const
+    {
+        std::size_t index = nearest(color);
+        return index == npos ? Color() : _colors[index];
+    }
+
+private:
+    struct Node
+    {
+        float lab[3];
+        float chroma;
+        /// Largest chroma in the range this node is the root of
+        float range_chroma;
+        uint32_t index;
+        int axis;
+    };
+
+    /**
+     * \brief Lower bound of the squared distance from a query
+     *
+     * Weights of the squared Lab differences to an entry with the given
+     * lightness and chroma. The a and b weight is
+     * ab_scale / (ab_base + ab_chroma * chroma)^2.
+     */
+    struct Bound
+    {
+        /// Slightly loosens the bound to absorb rounding in the full formulas
+        static constexpr float margin = 0.999f;
+
+        float lab[3];
+        /// Weight of the L difference for any entry in the palette
+        float l_weight;
+        /// Whether the L weight depends on the mean lightness (CIEDE2000 S_L)
+        bool l_weighted;
+        float ab_scale;
+        float ab_base;
+        float ab_chroma;
+
+        float l_weight_at(float l) const
+        {
+            if ( !l_weighted )
+                return l_weight;
+            float mean = (lab[0] + l) / 2 - 50;
+            float s_l = 1 + 0.015f * mean * mean / std::sqrt(20 + mean * mean);
+            return margin / (s_l * s_l);
+        }
+
+        float ab_weight(float chroma) const
+        {
+            float divisor = ab_base + ab_chroma * chroma;
+            return ab_scale / (divisor * divisor);
+        }
+    };
+
+    /**
+     * \brief Nearest index plus one for each 24 bit RGB value, 0 when missing
+     */
+    struct Cache
+    {
+        static constexpr std::size_t max_palette_size = 0xfffe;
+
+        std::once_flag allocated;
+        std::unique_ptr<std::atomic<uint16_t>[]> entries;
+    };
+
+    void build();
+    void build_index();
+    void build_tree(std::size_t begin, std::size_t end);
+    void search(const float* query, std::size_t begin, std::size_t end,
+                std::size_t& best, float& best_distance) const;
+    void search(const Bound& bound, std::size_t begin, std::size_t end,
+                std::size_t& best, float& best_distance) const;
+    Bound lower_bound(const repr::Lab& lab) const;
+    std::atomic<uint16_t>* cache() const;
+
+    std::vector<Color> _colors;
+    std::vector<repr::Lab> _lab;
+    /// Balanced k-d tree, the root of each range is at its midpoint
+    std::vector<Node> _tree;
+    DeltaE _metric = DeltaE::CIE76;
+    /// Lightness range of the entries, for the lower bounds of the distances
+    float _min_l = 0;
+    float _max_l = 0;
+
+    std::unique_ptr<Cache> _cache;
+};
+
+/**
+ * \brief Index of the xterm-256 entry closest to \p color
+ *
+ * Only the color cube and the grays are considered, the first 16 entries
+ * depend on the terminal theme. Lookups are memoized like Palette::nearest().
+ * \returns A value in [16, 255]
+ */
+uint8_t xterm256_nearest(const Color& color, DeltaE metric = DeltaE::CIE76);
+
+} // namespace color
+#endif // ASCEDIT_COLOR_PALETTE_HPP
@@ -0,0 +1,49 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rgb_int3_table.hpp"
+
+#include <vector>
+
+namespace color {
+namespace detail {
+
+static std::vector<uint8_t> build_rgb_int3_table24()
+{
+    std::vector<uint8_t> table(1 << 23);
+    for ( uint32_t rgb = 0; rgb < (1 << 24); rgb += 2 )
+    {
+        uint8_t low = pack_rgb_int3(Color(repr::RGB_int24(rgb)).to<repr::RGB_int3>());
+        uint8_t high = pack_rgb_int3(Color(repr::RGB_int24(rgb + 1)).to<repr::RGB_int3>());
+        table[rgb >> 1] = low | (high << 4);
+    }
+    return table;
+}
+
+const uint8_t* rgb_int3_table24()
+{
+    static const std::vector<uint8_t> table = build_rgb_int3_table24();
+    return table.data();
+}
+
+} // namespace detail
+} // namespace color
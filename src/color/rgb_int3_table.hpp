@@ -0,0 +1,103 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_RGB_INT3_TABLE_HPP
+#define ASCEDIT_COLOR_RGB_INT3_TABLE_HPP
+
+#include "color.hpp"
+
+namespace color {
+
+namespace detail {
+
+/**
+ * \brief Packs a repr::RGB_int3 in 4 bits
+ */
+constexpr uint8_t pack_rgb_int3(repr::RGB_int3 value)
+{
+    return value.rgb | (value.bright << 3);
+}
+
+constexpr repr::RGB_int3 unpack_rgb_int3(uint8_t packed)
+{
+    return repr::RGB_int3(packed & 0b111, packed & 0b1000);
+}
+
+/**
+ * \brief repr::RGB_int3 for every repr::RGB_int12 value
+ */
+struct RGBInt3Table12
+{
+    uint8_t values[1 << 12];
+
+    constexpr RGBInt3Table12()
+        : values{}
+    {
+        for ( int i = 0; i < (1 << 12); i++ )
+            values[i] = pack_rgb_int3(Color(repr::RGB_int12(i)).to<repr::RGB_int3>());
+    }
+};
+
+template<class = void>
+    struct RGBInt3Tables
+{
+    static constexpr RGBInt3Table12 table12{};
+};
+
+template<class T>
+    constexpr RGBInt3Table12 RGBInt3Tables<T>::table12;
+
+/**
+ * \brief repr::RGB_int3 for every 24 bit color, two entries per byte
+ *
+ * Takes 8 MiB, built on the first call.
+ */
+const uint8_t* rgb_int3_table24();
+
+} // namespace detail
+
+/**
+ * \brief Converts to repr::RGB_int3 by looking up the 12 bit version of \p color
+ *
+ * This is the same as converting Color(color.to<repr::RGB_int12>()),
+ * colors close to the thresholds might differ from Color::to<repr::RGB_int3>().
+ * \note This operation is only defined for valid colors
+ */
+constexpr repr::RGB_int3 rgb_int3_lookup(const Color& color)
+{
+    return detail::unpack_rgb_int3(
+        detail::RGBInt3Tables<>::table12.values[color.to<repr::RGB_int12>().rgb]
+    );
+}
+
+/**
+ * \brief Same result as Color::to<repr::RGB_int3>() using a table with
+ * an entry for every 24 bit color
+ * \note This operation is only defined for valid colors
+ */
+inline repr::RGB_int3 rgb_int3_lookup_exact(const Color& color)
+{
+    uint32_t index = color.to<repr::RGB_int24>().rgb;
+    uint8_t pair = detail::rgb_int3_table24()[index >> 1];
+    return detail::unpack_rgb_int3((index & 1) ? pair >> 4 : pair & 0xf);
+}
+
+} // namespace color
+#endif // ASCEDIT_COLOR_RGB_INT3_TABLE_HPP
@@ -0,0 +1,138 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_COLOR_TERMINAL_PALETTE_HPP
+#define ASCEDIT_COLOR_TERMINAL_PALETTE_HPP
+
+#include <cstddef>
+
+#include "color.hpp"
+
+namespace color {
+
+/**
+ * \brief Color of an entry of the 16 color terminal palette
+ *
+ * Entries are in SGR order: bit 0 is red, bit 1 green, bit 2 blue and
+ * bit 3 selects the bright variant, as in repr::RGB_int3.
+ */
+constexpr Color terminal16_color(int index)
+{
+    return Color(repr::RGB_int3(index & 0b111, index & 0b1000));
+}
+
+/**
+ * \brief Level of a channel in the 6x6x6 color cube of xterm-256
+ */
+constexpr uint8_t xterm256_cube_level(int index)
+{
+    return index ? 55 + index * 40 : 0;
+}
+
+/**
+ * \brief Color of an entry of the xterm 256 color palette
+ *
+ * The first 16 entries are the ones of terminal16_color(), followed by
+ * the 6x6x6 color cube and by 24 shades of gray.
+ */
+constexpr Color xterm256_color(int index)
+{
+    if ( index < 16 )
+        return terminal16_color(index);
+
+    if ( index < 232 )
+    {
+        int cube = index - 16;
+        return Color(
+            xterm256_cube_level(cube / 36),
+            xterm256_cube_level(cube / 6 % 6),
+            xterm256_cube_level(cube % 6)
+        );
+    }
+
+    uint8_t gray = 8 + (index - 232) * 10;
+    return Color(gray, gray, gray);
+}
+
+/**
+ * \brief Fixed palette with its colors already converted to Lab and HSV
+ *
+ * Meant to be built at compile time, see terminal16_palette() and
+ * xterm256_palette().
+ */
+template<std::size_t Size>
+    struct PaletteTable
+{
+    static constexpr std::size_t size = Size;
+
+    Color colors[Size];
+    repr::Lab lab[Size];
+    repr::HSVf hsv[Size];
+
+    constexpr explicit PaletteTable(Color (*color)(int))
+        : colors{}, lab{}, hsv{}
+    {
+        for ( std::size_t i = 0; i < Size; i++ )
+        {
+            colors[i] = color(i);
+            lab[i] = colors[i].template to<repr::Lab>();
+            hsv[i] = colors[i].template to<repr::HSVf>();
+        }
+    }
+};
+
+template<std::size_t Size>
+    constexpr std::size_t PaletteTable<Size>::size;
+
+namespace detail {
+
+template<class = void>
+    struct PaletteTables
+{
+    static constexpr PaletteTable<16> terminal16{terminal16_color};
+    static constexpr PaletteTable<256> xterm256{xterm256_color};
+};
+
+template<class T>
+    constexpr PaletteTable<16> PaletteTables<T>::terminal16;
+
+template<class T>
+    constexpr PaletteTable<256> PaletteTables<T>::xterm256;
+
+} // namespace detail
+
+/**
+ * \brief The 16 color terminal palette, computed at compile time
+ */
+constexpr const PaletteTable<16>& terminal16_palette()
+{
+    return detail::PaletteTables<>::terminal16;
+}
+
+/**
+ * \brief The xterm 256 color palette, computed at compile time
+ */
+constexpr const PaletteTable<256>& xterm256_palette()
+{
+    return detail::PaletteTables<>::xterm256;
+}
+
+} // namespace color
+#endif // ASCEDIT_COLOR_TERMINAL_PALETTE_HPP
@@ -0,0 +1,107 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ansi_writer.hpp"
+
+#include <cstring>
+
+#include "color/palette.hpp"
+
+namespace doc {
+
+constexpr uint32_t AnsiWriter::no_style;
+
+static const char reset_sgr[] = "\x1b[0m";
+
+AnsiWriter::AnsiWriter(const Document& document, AnsiColors colors)
+    : _composite(document.composite())
+{
+    _styles.reserve(document.layer_count());
+    for ( int i = 0; i < document.layer_count(); i++ )
+        _styles.push_back(style(document.layer(i)->color(), colors));
+
+    // The sequences don't depend on the layout
+    std::size_t sequences = 0;
+    uint32_t current = no_style;
+    _layout = TextLayout(_composite,
+        [this, &sequences, &current](const Document::CompositeMap::value_type& pair) {
+            const Style& style = _styles[pair.second.layer];
+            if ( style.id != current )
+            {
+                sequences += style.sgr.size();
+                current = style.id;
+            }
+        }
+    );
+
+    _size = _layout.size() + sequences;
+    if ( current != no_style )
+        _size += sizeof(reset_sgr) - 1;
+}
+
+AnsiWriter::Style AnsiWriter::style(unsigned color, AnsiColors colors)
+{
+    color::Color rgb{color::repr::RGB_int24(color & 0xffffff)};
+    if ( colors == AnsiColors::Xterm256 )
+    {
+        uint8_t index = color::xterm256_nearest(rgb);
+        return {"\x1b[38;5;" + std::to_string(index) + "m", index};
+    }
+
+    return {
+        "\x1b[38;2;" + std::to_string(rgb.red()) + ';' +
+        std::to_string(rgb.green()) + ';' + std::to_string(rgb.blue()) + 'm',
+        color & 0xffffff
+    };
+}
+
+char* AnsiWriter::write(char* out) const
+{
+    uint32_t current = no_style;
+    out = _layout.write(_composite, out, [this, &current](char* out, const CompositeCell& cell) {
+        const Style& style = _styles[cell.layer];
+        if ( style.id != current )
+        {
+            std::memcpy(out, style.sgr.data(), style.sgr.size());
+            out += style.sgr.size();
+            current = style.id;
+        }
+        *out = cell.character;
+        return out + 1;
+    });
+
+    if ( current != no_style )
+    {
+        std::memcpy(out, reset_sgr, sizeof(reset_sgr) - 1);
+        out += sizeof(reset_sgr) - 1;
+    }
+    return out;
+}
+
+void AnsiWriter::write(std::string& buffer) const
+{
+    buffer.resize(_size);
+    if ( _size )
+        write(&buffer[0]);
+}
+
+} // namespace doc
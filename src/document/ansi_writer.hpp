@@ -0,0 +1,113 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_ANSI_WRITER_HPP
+#define ASCEDIT_ANSI_WRITER_HPP
+
+#include <string>
+#include <vector>
+
+#include "document.hpp"
+#include "text_writer.hpp"
+
+namespace doc {
+
+/**
+ * \brief Color escape sequences supported by AnsiWriter
+ */
+enum class AnsiColors
+{
+    /// Nearest entry of the xterm 256 color cube or gray ramp
+    Xterm256,
+    /// 24 bit colors
+    TrueColor,
+};
+
+/**
+ * \brief Serializes the visible cells of a Document as colored text
+ *
+ * The text is laid out by TextLayout. Each character is preceded
+ * by an SGR sequence setting the foreground to the color of its layer,
+ * unless it's the same color as the character written before it.
+ * If any color has been set, the output ends with a reset sequence.
+ *
+ * The constructor scans the document once to find the exact output size,
+ * the sequences are computed once per layer. The document must not change
+ * while the writer is in use.
+ */
+class AnsiWriter
+{
+public:
+    AnsiWriter(const Document& document, AnsiColors colors);
+
+    /**
+     * \brief Exact number of bytes produced by write()
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * \brief Writes the text to a caller-supplied buffer
+     * \param out Buffer with room for at least size() bytes
+     * \returns Pointer past the last written byte
+     */
+    char* write(char* out) const;
+
+    /**
+     * \brief Replaces the contents of \p buffer with the text
+     *
+     * Reusing the same buffer for multiple frames avoids allocations
+     * once it has grown to the size of the largest one.
+     */
+    void write(std::string& buffer) const;
+
+    std::string to_string() const
+    {
+        std::string ret;
+        write(ret);
+        return ret;
+    }
+
+private:
+    /**
+     * \brief Escape sequence for the color of a layer
+     */
+    struct Style
+    {
+        std::string sgr;
+        /// Equal for layers with the same output color
+        uint32_t id;
+    };
+
+    /// Id of the style before any sequence has been written
+    static constexpr uint32_t no_style = -1;
+
+    static Style style(unsigned color, AnsiColors colors);
+
+    const Document::CompositeMap& _composite;
+    std::vector<Style> _styles;
+    TextLayout _layout;
+    std::size_t _size = 0;
+};
+
+} // namespace doc
+#endif // ASCEDIT_ANSI_WRITER_HPP
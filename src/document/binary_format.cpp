@@ -0,0 +1,392 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "binary_format.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace doc {
+namespace binary {
+
+namespace {
+
+template<class T>
+    void put_le(char* out, T value)
+{
+    for ( std::size_t i = 0; i < sizeof(T); i++ )
+        out[i] = char(uint64_t(value) >> (8 * i));
+}
+
+void write_varint(std::vector<char>& out, uint64_t value)
+{
+    while ( value >= 0x80 )
+    {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+bool read_varint(const char*& data, const char* end, uint64_t& value)
+{
+    value = 0;
+    for ( int shift = 0; data != end && shift < 64; shift += 7 )
+    {
+        uint8_t byte = *data++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ( !(byte & 0x80) )
+            return true;
+    }
+    return false;
+}
+
+std::size_t align(std::size_t offset)
+{
+    return (offset + 7) & ~std::size_t(7);
+}
+
+/**
+ * \brief Encodes a run of contiguous characters, \p gap empty cells
+ * after the previous one
+ */
+void write_segment(std::vector<char>& out, std::size_t gap, const std::string& chars)
+{
+    auto write_span = [&out, &gap](const char* data, std::size_t length, bool repeat) {
+        write_varint(out, gap);
+        write_varint(out, (uint64_t(length) << 1) | repeat);
+        out.insert(out.end(), data, data + (repeat ? 1 : length));
+        gap = 0;
+    };
+
+    std::size_t literal = 0;
+    for ( std::size_t i = 0; i < chars.size(); )
+    {
+        std::size_t j = i + 1;
+        while ( j < chars.size() && chars[j] == chars[i] )
+            j++;
+
+        if ( j - i >= min_repeat )
+        {
+            if ( literal < i )
+                write_span(chars.data() + literal, i - literal, false);
+            write_span(chars.data() + i, j - i, true);
+            literal = j;
+        }
+        i = j;
+    }
+
+    if ( literal < chars.size() )
+        write_span(chars.data() + literal, chars.size() - literal, false);
+}
+
+/**
+ * \brief Span data and row table of a single layer
+ */
+struct EncodedLayer
+{
+    unsigned color;
+    std::vector<char> rows;
+    std::vector<char> data;
+    std::size_t row_count = 0;
+
+    EncodedLayer(unsigned color, const Layer::CharacterMap& characters)
+        : color(color)
+    {
+        bool has_row = false;
+        std::string segment;
+        int segment_x = 0;
+        int row_y = 0;
+        int row_x = 0;
+        int last_x = 0;
+        std::size_t row_start = 0;
+
+        auto flush_segment = [&]() {
+            if ( !segment.empty() )
+                write_segment(data, segment_x - last_x, segment);
+            last_x = segment_x + segment.size();
+            segment.clear();
+        };
+
+        auto flush_row = [&]() {
+            flush_segment();
+            std::size_t entry = rows.size();
+            rows.resize(entry + row_entry_size);
+            put_le(rows.data() + entry, uint32_t(row_y));
+            put_le(rows.data() + entry + 4, uint32_t(row_x));
+            put_le(rows.data() + entry + 8, uint32_t(data.size() - row_start));
+            put_le(rows.data() + entry + 12, uint32_t(0));
+            put_le(rows.data() + entry + 16, uint64_t(row_start));
+            row_count++;
+        };
+
+        for ( const auto& pair : characters )
+        {
+            QPoint pos = pair.first;
+            if ( !has_row || pos.y() != row_y )
+            {
+                if ( has_row )
+                    flush_row();
+                has_row = true;
+                row_y = pos.y();
+                row_x = last_x = segment_x = pos.x();
+                row_start = data.size();
+            }
+            else if ( pos.x() != segment_x + int(segment.size()) )
+            {
+                flush_segment();
+                segment_x = pos.x();
+            }
+            segment.push_back(pair.second);
+        }
+
+        if ( has_row )
+            flush_row();
+    }
+};
+
+/**
+ * \brief Decodes the spans of \p row, calling
+ * span(int x, const char* data, std::size_t length, bool repeat) for each
+ * \returns \b false if the span data is malformed
+ */
+template<class Function>
+    bool for_each_span(const LayerView::Row& row, Function span)
+{
+    const char* data = row.data;
+    const char* data_end = data + row.size;
+    int64_t x = row.x;
+    while ( data != data_end )
+    {
+        uint64_t gap, length;
+        if ( !read_varint(data, data_end, gap) || !read_varint(data, data_end, length) )
+            return false;
+
+        bool is_repeat = length & 1;
+        length >>= 1;
+        // The gap comes from the file, it could wrap x around
+        int64_t room = int64_t(std::numeric_limits<int>::max()) - x;
+        if ( room < 0 || gap > uint64_t(room) )
+            return false;
+        x += gap;
+        if ( length > uint64_t(std::numeric_limits<int>::max()) ||
+             x + int64_t(length) - 1 > std::numeric_limits<int>::max() )
+            return false;
+
+        std::size_t size = is_repeat ? 1 : length;
+        if ( std::size_t(data_end - data) < size )
+            return false;
+        span(int(x), data, std::size_t(length), is_repeat);
+        data += size;
+        x += length;
+    }
+    return true;
+}
+
+} // namespace
+
+bool LayerView::load_rows(Layer& layer, int first, int last) const
+{
+    // Binary search on the row table
+    std::size_t begin = 0;
+    std::size_t end = _row_count;
+    while ( begin < end )
+    {
+        std::size_t middle = begin + (end - begin) / 2;
+        if ( row(middle).y < first )
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    end = begin;
+    while ( end < _row_count && row(end).y < last )
+        end++;
+
+    // Everything is checked first so a malformed file leaves the layer as is
+    auto ignore = [](int, const char*, std::size_t, bool) {};
+    for ( std::size_t index = begin; index < end; index++ )
+        if ( !for_each_span(row(index), ignore) )
+            return false;
+
+    Layer::EditBatch batch(layer);
+    std::string repeat;
+    for ( std::size_t index = begin; index < end; index++ )
+    {
+        int y = row(index).y;
+        for_each_span(row(index), [&layer, &repeat, y](int x, const char* data, std::size_t length, bool is_repeat) {
+            if ( !is_repeat )
+            {
+                layer.set_row(QPoint(x, y), data, length);
+                return;
+            }
+
+            // Bounded buffer, the length comes from the file
+            repeat.assign(std::min<std::size_t>(length, 4096), *data);
+            for ( std::size_t done = 0; done < length; done += repeat.size() )
+                layer.set_row(QPoint(x + int(done), y), repeat.data(),
+                              std::min(length - done, repeat.size()));
+        });
+    }
+
+    return true;
+}
+
+DocumentView::DocumentView(const char* data, std::size_t size)
+{
+    if ( size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0 ||
+         detail::read_le<uint16_t>(data + 4) != version )
+        return;
+
+    std::size_t layer_count = detail::read_le<uint32_t>(data + 8);
+    if ( layer_count > (size - header_size) / layer_entry_size )
+        return;
+
+    _layers.resize(layer_count);
+    for ( std::size_t i = 0; i < layer_count; i++ )
+    {
+        const char* entry = data + header_size + i * layer_entry_size;
+        LayerView& layer = _layers[i];
+        layer._color = detail::read_le<uint32_t>(entry);
+        layer._row_count = detail::read_le<uint32_t>(entry + 4);
+        uint64_t rows_offset = detail::read_le<uint64_t>(entry + 8);
+        uint64_t data_offset = detail::read_le<uint64_t>(entry + 16);
+        uint64_t data_size = detail::read_le<uint64_t>(entry + 24);
+
+        if ( rows_offset > size || layer._row_count > (size - rows_offset) / row_entry_size ||
+             data_offset > size || data_size > size - data_offset )
+        {
+            _layers.clear();
+            return;
+        }
+        layer._rows = data + rows_offset;
+        layer._data = data + data_offset;
+
+        // Checking rows here keeps LayerView::row() safe and
+        // LayerView::load_rows() can binary search on sorted rows
+        for ( std::size_t row = 0; row < layer._row_count; row++ )
+        {
+            const char* row_entry = layer._rows + row * row_entry_size;
+            uint64_t offset = detail::read_le<uint64_t>(row_entry + 16);
+            uint64_t row_size = detail::read_le<uint32_t>(row_entry + 8);
+            if ( offset > data_size || row_size > data_size - offset ||
+                 (row > 0 && layer.row(row - 1).y >= layer.row(row).y) )
+            {
+                _layers.clear();
+                return;
+            }
+        }
+    }
+
+    _valid = true;
+}
+
+MappedDocument::MappedDocument(const QString& file_name)
+    : _file(file_name)
+{
+    if ( !_file.open(QIODevice::ReadOnly) )
+        return;
+
+    std::size_t size = _file.size();
+    if ( size < header_size )
+        return;
+
+    if ( const uchar* data = _file.map(0, size) )
+        _view = DocumentView(reinterpret_cast<const char*>(data), size);
+}
+
+namespace {
+
+std::vector<char> encode(const std::vector<EncodedLayer>& encoded)
+{
+    std::size_t size = header_size + encoded.size() * layer_entry_size;
+    for ( const auto& layer : encoded )
+        size = align(align(size + layer.rows.size()) + layer.data.size());
+
+    std::vector<char> out(size, 0);
+    std::memcpy(out.data(), magic, sizeof(magic));
+    put_le(out.data() + 4, version);
+    put_le(out.data() + 8, uint32_t(encoded.size()));
+
+    std::size_t offset = header_size + encoded.size() * layer_entry_size;
+    for ( std::size_t i = 0; i < encoded.size(); i++ )
+    {
+        const EncodedLayer& layer = encoded[i];
+        std::size_t rows_offset = offset;
+        std::size_t data_offset = align(rows_offset + layer.rows.size());
+
+        char* entry = out.data() + header_size + i * layer_entry_size;
+        put_le(entry, uint32_t(layer.color));
+        put_le(entry + 4, uint32_t(layer.row_count));
+        put_le(entry + 8, uint64_t(rows_offset));
+        put_le(entry + 16, uint64_t(data_offset));
+        put_le(entry + 24, uint64_t(layer.data.size()));
+
+        std::copy(layer.rows.begin(), layer.rows.end(), out.begin() + rows_offset);
+        std::copy(layer.data.begin(), layer.data.end(), out.begin() + data_offset);
+        offset = align(data_offset + layer.data.size());
+    }
+
+    return out;
+}
+
+bool write_data(const std::vector<char>& data, const QString& file_name)
+{
+    QFile file(file_name);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+        return false;
+
+    return file.write(data.data(), data.size()) == qint64(data.size());
+}
+
+} // namespace
+
+std::vector<char> encode(const std::vector<const Layer*>& layers)
+{
+    std::vector<EncodedLayer> encoded;
+    encoded.reserve(layers.size());
+    for ( const Layer* layer : layers )
+        encoded.emplace_back(layer->color(), layer->characters());
+    return encode(encoded);
+}
+
+std::vector<char> encode(const std::vector<Layer::Snapshot>& layers)
+{
+    std::vector<EncodedLayer> encoded;
+    encoded.reserve(layers.size());
+    for ( const Layer::Snapshot& layer : layers )
+        encoded.emplace_back(layer.color, layer.characters);
+    return encode(encoded);
+}
+
+bool write_file(const std::vector<const Layer*>& layers, const QString& file_name)
+{
+    return write_data(encode(layers), file_name);
+}
+
+bool write_file(const std::vector<Layer::Snapshot>& layers, const QString& file_name)
+{
+    return write_data(encode(layers), file_name);
+}
+
+} // namespace binary
+} // namespace doc
@@ -0,0 +1,258 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_BINARY_FORMAT_HPP
+#define ASCEDIT_BINARY_FORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include "layer.hpp"
+
+namespace doc {
+
+/**
+ * \brief Compact binary document format
+ *
+ * All integers are little endian, sections are aligned to 8 bytes.
+ *
+ * \code
+ * Header      magic "ASCD", uint16 version, uint16 flags (0),
+ *             uint32 layer count, uint32 reserved (0)
+ * LayerEntry  for each layer: uint32 color, uint32 row count,
+ *             uint64 row table offset, uint64 span data offset,
+ *             uint64 span data size
+ * RowEntry    for each non-empty row, sorted by y: int32 y, int32 x of the
+ *             first character, uint32 span data size, uint32 reserved (0),
+ *             uint64 offset from the start of the layer span data
+ * \endcode
+ *
+ * The span data of a row is a sequence of spans, each being:
+ * varint number of empty cells before the span, varint (length << 1 | repeat)
+ * followed by a single character repeated length times when repeat is 1,
+ * or by length literal characters.
+ * Varints are unsigned LEB128.
+ */
+namespace binary {
+
+constexpr char magic[4] = {'A', 'S', 'C', 'D'};
+constexpr uint16_t version = 1;
+
+/**
+ * \brief Runs of at least this many equal characters are stored as repeats
+ */
+constexpr std::size_t min_repeat = 4;
+
+constexpr std::size_t header_size = 16;
+constexpr std::size_t layer_entry_size = 32;
+constexpr std::size_t row_entry_size = 24;
+
+namespace detail {
+
+template<class T>
+    T read_le(const char* data)
+{
+    T value = 0;
+    for ( std::size_t i = 0; i < sizeof(T); i++ )
+        value |= T(uint8_t(data[i])) << (8 * i);
+    return value;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Tables are read in place, skip the byte shuffling when it's a no-op
+template<>
+    inline uint32_t read_le<uint32_t>(const char* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+template<>
+    inline uint64_t read_le<uint64_t>(const char* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+#endif
+
+} // namespace detail
+
+/**
+ * \brief Read-only view on a layer of an encoded document
+ *
+ * Rows are decoded directly from the encoded data on access.
+ */
+class LayerView
+{
+public:
+    struct Row
+    {
+        int y;
+        int x;
+        const char* data;
+        std::size_t size;
+    };
+
+    unsigned color() const
+    {
+        return _color;
+    }
+
+    std::size_t row_count() const
+    {
+        return _row_count;
+    }
+
+    /**
+     * \brief Row table entry \p index
+     * \pre index < row_count()
+     */
+    Row row(std::size_t index) const
+    {
+        const char* entry = _rows + index * row_entry_size;
+        return Row{
+            int32_t(detail::read_le<uint32_t>(entry)),
+            int32_t(detail::read_le<uint32_t>(entry + 4)),
+            _data + detail::read_le<uint64_t>(entry + 16),
+            detail::read_le<uint32_t>(entry + 8),
+        };
+    }
+
+    /**
+     * \brief Copies all the rows into \p layer
+     * \returns \b false if the span data is malformed, \p layer is
+     * left unchanged in that case
+     */
+    bool load(Layer& layer) const
+    {
+        return load_rows(layer, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+
+    /**
+     * \brief Copies the rows with y in [first, last) into \p layer
+     * \returns \b false if the span data is malformed, \p layer is
+     * left unchanged in that case
+     */
+    bool load_rows(Layer& layer, int first, int last) const;
+
+private:
+    friend class DocumentView;
+
+    unsigned _color = 0;
+    std::size_t _row_count = 0;
+    const char* _rows = nullptr;
+    const char* _data = nullptr;
+};
+
+/**
+ * \brief Read-only view on an encoded document, which must outlive the view
+ *
+ * The constructor only validates the header and the tables,
+ * nothing is copied.
+ */
+class DocumentView
+{
+public:
+    DocumentView() = default;
+    DocumentView(const char* data, std::size_t size);
+
+    bool is_valid() const
+    {
+        return _valid;
+    }
+
+    std::size_t layer_count() const
+    {
+        return _layers.size();
+    }
+
+    const LayerView& layer(std::size_t index) const
+    {
+        return _layers[index];
+    }
+
+private:
+    bool _valid = false;
+    std::vector<LayerView> _layers;
+};
+
+/**
+ * \brief Memory-mapped document file
+ */
+class MappedDocument
+{
+public:
+    /**
+     * \brief Maps and validates \p file_name, check is_valid() for errors
+     */
+    explicit MappedDocument(const QString& file_name);
+
+    MappedDocument(const MappedDocument&) = delete;
+    MappedDocument& operator=(const MappedDocument&) = delete;
+
+    bool is_valid() const
+    {
+        return _view.is_valid();
+    }
+
+    const DocumentView& view() const
+    {
+        return _view;
+    }
+
+private:
+    QFile _file;
+    DocumentView _view;
+};
+
+/**
+ * \brief Encodes the layers, bottom to top
+ */
+std::vector<char> encode(const std::vector<const Layer*>& layers);
+
+/**
+ * \brief Encodes layer snapshots, bottom to top
+ *
+ * Can be called from a background thread.
+ */
+std::vector<char> encode(const std::vector<Layer::Snapshot>& layers);
+
+/**
+ * \brief Encodes the layers to \p file_name
+ * \returns Whether the file has been written successfully
+ */
+bool write_file(const std::vector<const Layer*>& layers, const QString& file_name);
+
+/**
+ * \brief Encodes layer snapshots to \p file_name
+ * \returns Whether the file has been written successfully
+ */
+bool write_file(const std::vector<Layer::Snapshot>& layers, const QString& file_name);
+
+} // namespace binary
+} // namespace doc
+#endif // ASCEDIT_BINARY_FORMAT_HPP
@@ -0,0 +1,180 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "document.hpp"
+
+#include <algorithm>
+
+namespace doc {
+
+constexpr int Document::max_layers;
+
+int Document::layer_index(const Layer* layer) const
+{
+    auto it = _indices.find(layer);
+    return it == _indices.end() ? -1 : it->second;
+}
+
+void Document::update_indices(int first)
+{
+    for ( int i = first; i < layer_count(); i++ )
+        _indices[_layers[i].get()] = i;
+}
+
+Layer* Document::insert_layer(int index, unsigned color)
+{
+    Layer* layer = new Layer(color);
+    _layers.emplace(_layers.begin() + index, layer);
+    update_indices(index);
+    connect(layer, &Layer::region_changed, this, [this, layer](const QRect& region) {
+        layer_region_changed(layer, region);
+    });
+    connect(layer, &Layer::color_changed, this, [this, layer](unsigned) {
+        layer_color_changed(layer);
+    });
+
+    // The new layer is empty, the ones above have moved up by one
+    renumber(index, 1);
+    return layer;
+}
+
+void Document::remove_layer(int index)
+{
+    std::unique_ptr<Layer> removed = std::move(_layers[index]);
+    QRect region = bounding_rect(*removed);
+    _indices.erase(removed.get());
+    _layers.erase(_layers.begin() + index);
+    update_indices(index);
+
+    // Only the cells the removed layer was showing need a lookup below
+    for ( const auto& pair : removed->characters() )
+    {
+        CompositeCell cell = _composite.get(pair.first);
+        if ( cell.character && cell.layer == index )
+            show_below(pair.first, index);
+    }
+    renumber(index + 1, -1);
+
+    if ( region.isValid() )
+        emit region_changed(region);
+}
+
+void Document::layer_region_changed(const Layer* layer, const QRect& region)
+{
+    int index = layer_index(layer);
+
+    if ( qint64(region.width()) * region.height() <= CompositeMap::tile_size )
+    {
+        for ( int y = region.top(); y <= region.bottom(); y++ )
+            for ( int x = region.left(); x <= region.right(); x++ )
+                update_cell(QPoint(x, y), index);
+    }
+    else
+    {
+        // Large batches can have a sparse bounding rectangle, only the cells
+        // the layer has now or showed before can have changed
+        std::vector<QPoint> cells;
+        layer->characters().for_each_in(region, [&cells](QPoint pos, char) {
+            cells.push_back(pos);
+        });
+        _composite.for_each_in(region, [&cells, index](QPoint pos, const CompositeCell& cell) {
+            if ( cell.layer == index )
+                cells.push_back(pos);
+        });
+        for ( QPoint pos : cells )
+            update_cell(pos, index);
+    }
+
+    emit region_changed(region);
+}
+
+void Document::layer_color_changed(const Layer* layer)
+{
+    QRect region = bounding_rect(*layer);
+    if ( region.isValid() )
+        emit region_changed(region);
+}
+
+void Document::update_cell(QPoint pos, int index)
+{
+    CompositeCell current = _composite.get(pos);
+    int top = current.character ? current.layer : -1;
+
+    // Hidden by a layer above
+    if ( top > index )
+        return;
+
+    char character = _layers[index]->characters().get(pos);
+    if ( character )
+    {
+        _composite.set(pos, CompositeCell{character, uint16_t(index)});
+        return;
+    }
+
+    // The layer didn't have a character before either
+    if ( top < index )
+        return;
+
+    // The visible character has been removed, find the one below it
+    show_below(pos, index);
+}
+
+void Document::show_below(QPoint pos, int index)
+{
+    for ( int below = index - 1; below >= 0; below-- )
+    {
+        char character = _layers[below]->characters().get(pos);
+        if ( character )
+        {
+            _composite.set(pos, CompositeCell{character, uint16_t(below)});
+            return;
+        }
+    }
+    _composite.erase(pos);
+}
+
+void Document::renumber(int first, int delta)
+{
+    if ( first + delta >= layer_count() )
+        return;
+
+    std::vector<std::pair<QPoint, CompositeCell>> moved;
+    for ( const auto& pair : _composite )
+        if ( pair.second.layer >= first )
+            moved.push_back(pair);
+
+    for ( auto& pair : moved )
+    {
+        pair.second.layer += delta;
+        _composite.set(pair.first, pair.second);
+    }
+}
+
+QRect Document::bounding_rect(const Layer& layer)
+{
+    QRect rect;
+    for ( const auto& pair : layer.characters() )
+        rect |= QRect(pair.first, QSize(1, 1));
+    return rect;
+}
+
+} // namespace doc
@@ -0,0 +1,197 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_DOCUMENT_HPP
+#define ASCEDIT_DOCUMENT_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+#include <QRect>
+
+#include "layer.hpp"
+
+namespace doc {
+
+/**
+ * \brief Cell of the flattened document
+ */
+struct CompositeCell
+{
+    /// Topmost visible character, 0 if no layer has one
+    char character = 0;
+    /// Index of the layer the character comes from
+    uint16_t layer = 0;
+
+    bool operator==(const CompositeCell& oth) const
+    {
+        return character == oth.character && layer == oth.layer;
+    }
+
+    bool operator!=(const CompositeCell& oth) const
+    {
+        return !(*this == oth);
+    }
+};
+
+/**
+ * \brief Stack of layers, the first layer is at the bottom
+ *
+ * The document keeps a flattened copy of the layers with the topmost
+ * character of every cell, so lookups don't depend on the number of layers.
+ * The copy is updated from the regions reported by Layer::region_changed,
+ * only cells whose topmost layer might have changed are scanned.
+ * Inserting or removing a layer below the top renumbers the composite
+ * cells of the layers above it, without scanning the other layers.
+ */
+class Document : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef TileMap<CompositeCell> CompositeMap;
+
+    /**
+     * \brief Visible content of a cell
+     */
+    struct Cell
+    {
+        char character = ' ';
+        unsigned color = 0;
+        /// Index of the layer showing the character, -1 for empty cells
+        int layer = -1;
+    };
+
+    /**
+     * \brief Maximum number of layers, limited by CompositeCell::layer
+     */
+    static constexpr int max_layers = 0xffff;
+
+    Document() = default;
+
+    int layer_count() const
+    {
+        return _layers.size();
+    }
+
+    Layer* layer(int index) const
+    {
+        return _layers[index].get();
+    }
+
+    /**
+     * \brief Index of \p layer in the stack or -1 if it isn't in this document
+     */
+    int layer_index(const Layer* layer) const;
+
+    /**
+     * \brief Adds a new empty layer on top of the others
+     */
+    Layer* add_layer(unsigned color)
+    {
+        return insert_layer(layer_count(), color);
+    }
+
+    /**
+     * \brief Adds a new empty layer at \p index
+     * \pre 0 <= index <= layer_count() < max_layers
+     */
+    Layer* insert_layer(int index, unsigned color);
+
+    /**
+     * \brief Removes and deletes the layer at \p index
+     */
+    void remove_layer(int index);
+
+    /**
+     * \brief Visible character and color at \p pos
+     */
+    Cell cell_at(QPoint pos) const
+    {
+        Cell cell;
+        CompositeCell composite = _composite.get(pos);
+        if ( composite.character )
+        {
+            cell.character = composite.character;
+            cell.layer = composite.layer;
+            cell.color = _layers[composite.layer]->color();
+        }
+        return cell;
+    }
+
+    /**
+     * \brief Flattened document
+     */
+    const CompositeMap& composite() const
+    {
+        return _composite;
+    }
+
+signals:
+    /**
+     * \brief Emitted when visible cells in \p region may have changed
+     */
+    void region_changed(const QRect& region);
+
+private:
+    void layer_region_changed(const Layer* layer, const QRect& region);
+
+    /**
+     * \brief Repaints the cells of \p layer after its color has changed
+     */
+    void layer_color_changed(const Layer* layer);
+
+    /**
+     * \brief Updates _indices for the layers from \p first to the top
+     */
+    void update_indices(int first);
+
+    /**
+     * \brief Updates the composite cell at \p pos after a change in layer \p index
+     */
+    void update_cell(QPoint pos, int index);
+
+    /**
+     * \brief Shows at \p pos the topmost character of the layers below
+     * \p index, or empties the cell
+     */
+    void show_below(QPoint pos, int index);
+
+    /**
+     * \brief Adds \p delta to the layer of the composite cells coming
+     * from layer \p first or above, after a layer has been inserted or removed
+     */
+    void renumber(int first, int delta);
+
+    /**
+     * \brief Bounding rectangle of all the characters of \p layer
+     */
+    static QRect bounding_rect(const Layer& layer);
+
+    std::vector<std::unique_ptr<Layer>> _layers;
+    /// Index of each layer in _layers, to map signals to layers quickly
+    std::unordered_map<const Layer*, int> _indices;
+    CompositeMap _composite;
+};
+
+} // namespace doc
+#endif // ASCEDIT_DOCUMENT_HPP
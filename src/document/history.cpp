@@ -0,0 +1,355 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "history.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace doc {
+
+/**
+ * \brief Changed cells on a row closer than this are stored as a single run
+ *
+ * Splitting a run costs a RowDelta, about as much as this many unchanged
+ * cells stored twice.
+ */
+static constexpr std::size_t min_gap = 16;
+
+constexpr int History::Capture::max_row_height;
+
+bool History::Capture::covers(QPoint pos) const
+{
+    for ( const QRect& rect : rects )
+        if ( rect.contains(pos) )
+            return true;
+
+    auto row = rows.find(pos.y());
+    if ( row == rows.end() )
+        return false;
+    auto span = row->second.upper_bound(pos.x());
+    return span != row->second.begin() && pos.x() < std::prev(span)->second;
+}
+
+void History::Capture::add(const QRect& region)
+{
+    if ( region.height() > max_row_height )
+    {
+        rects.push_back(region);
+        return;
+    }
+
+    for ( int y = region.top(); y <= region.bottom(); y++ )
+    {
+        auto& row = rows[y];
+        int start = region.left();
+        int end = region.right() + 1;
+
+        // Merge with the ranges overlapping or touching [start, end)
+        auto it = row.upper_bound(start);
+        if ( it != row.begin() && std::prev(it)->second >= start )
+            --it;
+        while ( it != row.end() && it->first <= end )
+        {
+            start = std::min(start, it->first);
+            end = std::max(end, it->second);
+            it = row.erase(it);
+        }
+        row.emplace_hint(it, start, end);
+    }
+}
+
+template<class Function>
+    void History::Capture::for_each_area(Function function) const
+{
+    for ( const auto& row : rows )
+        for ( const auto& span : row.second )
+            function(QRect(span.first, row.first, span.second - span.first, 1));
+    for ( const QRect& rect : rects )
+        function(rect);
+}
+
+std::size_t History::Step::memory() const
+{
+    std::size_t bytes = sizeof(Step);
+    for ( const RowDelta& row : rows )
+        bytes += sizeof(RowDelta) + row.before.size() + row.after.size();
+    return bytes;
+}
+
+void History::track(Layer* layer)
+{
+    _colors[layer] = layer->color();
+
+    connect(layer, &Layer::about_to_change, this, [this, layer](const QRect& region) {
+        capture(layer, region);
+    });
+    connect(layer, &Layer::region_changed, this, [this, layer](const QRect&) {
+        if ( !_applying )
+            commit(layer);
+    });
+    connect(layer, &Layer::color_changed, this, [this, layer](unsigned color) {
+        unsigned& old_color = _colors[layer];
+        if ( !_applying )
+        {
+            Step step;
+            step.layer = layer;
+            step.color = true;
+            step.color_before = old_color;
+            step.color_after = color;
+            push(std::move(step));
+        }
+        old_color = color;
+    });
+    connect(layer, &QObject::destroyed, this, [this, layer](QObject*) {
+        forget(layer);
+    });
+}
+
+bool History::undo()
+{
+    commit_all();
+    if ( _undo.empty() )
+        return false;
+
+    _redo.push_back(std::move(_undo.back()));
+    _undo.pop_back();
+    apply(_redo.back(), true);
+    _merge_barrier = true;
+    return true;
+}
+
+bool History::redo()
+{
+    commit_all();
+    if ( _redo.empty() )
+        return false;
+
+    _undo.push_back(std::move(_redo.back()));
+    _redo.pop_back();
+    apply(_undo.back(), false);
+    _merge_barrier = true;
+    return true;
+}
+
+void History::clear()
+{
+    _undo.clear();
+    _redo.clear();
+    _pending.clear();
+    _memory = 0;
+}
+
+void History::set_memory_limit(std::size_t bytes)
+{
+    _memory_limit = bytes;
+    trim();
+}
+
+void History::capture(Layer* layer, const QRect& region)
+{
+    if ( _applying || region.isEmpty() )
+        return;
+
+    // Cells seen in an earlier area already have their oldest contents
+    Capture& capture = _pending[layer];
+    layer->characters().for_each_in(region, [&capture](QPoint pos, char ch) {
+        if ( !capture.covers(pos) )
+            capture.before.emplace(pos, ch);
+    });
+    capture.add(region);
+}
+
+void History::commit(Layer* layer)
+{
+    auto found = _pending.find(layer);
+    if ( found == _pending.end() )
+        return;
+
+    Capture capture = std::move(found->second);
+    _pending.erase(found);
+
+    std::map<QPoint, char, Layer::QPointCmp> after;
+    capture.for_each_area([layer, &after](const QRect& area) {
+        layer->characters().for_each_in(area, [&after](QPoint pos, char ch) {
+            after.emplace(pos, ch);
+        });
+    });
+
+    // Cells missing from both maps were empty before and after the edit
+    struct Change
+    {
+        QPoint pos;
+        char before;
+        char after;
+    };
+    std::vector<Change> changes;
+    Layer::QPointCmp less;
+    auto old_it = capture.before.begin();
+    auto new_it = after.begin();
+    while ( old_it != capture.before.end() || new_it != after.end() )
+    {
+        Change change;
+        if ( new_it == after.end() || (old_it != capture.before.end() && less(old_it->first, new_it->first)) )
+        {
+            change = Change{old_it->first, old_it->second, '\0'};
+            ++old_it;
+        }
+        else if ( old_it == capture.before.end() || less(new_it->first, old_it->first) )
+        {
+            change = Change{new_it->first, '\0', new_it->second};
+            ++new_it;
+        }
+        else
+        {
+            change = Change{old_it->first, old_it->second, new_it->second};
+            ++old_it;
+            ++new_it;
+        }
+        if ( change.before != change.after )
+            changes.push_back(change);
+    }
+
+    Step step;
+    step.layer = layer;
+    step.merge_id = _merge_id;
+    for ( std::size_t first = 0; first < changes.size(); )
+    {
+        std::size_t last = first;
+        while ( last + 1 < changes.size() &&
+                changes[last + 1].pos.y() == changes[first].pos.y() &&
+                changes[last + 1].pos.x() - changes[last].pos.x() <= int(min_gap) )
+            last++;
+
+        // Unchanged cells between the changes keep their current contents
+        int x = changes[first].pos.x();
+        int y = changes[first].pos.y();
+        int width = changes[last].pos.x() - x + 1;
+        RowDelta row{y, x, std::string(), std::string(width, '\0')};
+        layer->characters().for_each_in(QRect(x, y, width, 1), [&row, x](QPoint pos, char ch) {
+            row.after[pos.x() - x] = ch;
+        });
+        row.before = row.after;
+        for ( std::size_t i = first; i <= last; i++ )
+            row.before[changes[i].pos.x() - x] = changes[i].before;
+
+        step.rows.push_back(std::move(row));
+        first = last + 1;
+    }
+
+    if ( !step.rows.empty() )
+        push(std::move(step));
+}
+
+void History::commit_all()
+{
+    while ( !_pending.empty() )
+        commit(_pending.begin()->first);
+}
+
+void History::push(Step&& step)
+{
+    for ( const Step& undone : _redo )
+        _memory -= undone.memory();
+    _redo.clear();
+
+    if ( !_merge_barrier && step.merge_id >= 0 && !_undo.empty() )
+    {
+        Step& last = _undo.back();
+        if ( last.merge_id == step.merge_id && last.layer == step.layer &&
+             !last.color && !step.color )
+        {
+            _memory -= last.memory();
+            std::move(step.rows.begin(), step.rows.end(), std::back_inserter(last.rows));
+            _memory += last.memory();
+            trim();
+            return;
+        }
+    }
+
+    _merge_barrier = false;
+    _memory += step.memory();
+    _undo.push_back(std::move(step));
+    trim();
+}
+
+void History::forget(Layer* layer)
+{
+    auto removed = [this, layer](const Step& step) {
+        if ( step.layer != layer )
+            return false;
+        _memory -= step.memory();
+        return true;
+    };
+    _undo.erase(std::remove_if(_undo.begin(), _undo.end(), removed), _undo.end());
+    _redo.erase(std::remove_if(_redo.begin(), _redo.end(), removed), _redo.end());
+    _pending.erase(layer);
+    _colors.erase(layer);
+    _merge_barrier = true;
+}
+
+void History::trim()
+{
+    if ( !_memory_limit )
+        return;
+
+    // The furthest redo steps are the least likely to be needed
+    while ( _memory > _memory_limit && !_redo.empty() )
+    {
+        _memory -= _redo.front().memory();
+        _redo.erase(_redo.begin());
+    }
+
+    while ( _memory > _memory_limit && _undo.size() > 1 )
+    {
+        _memory -= _undo.front().memory();
+        _undo.pop_front();
+    }
+}
+
+void History::apply(const Step& step, bool before)
+{
+    _applying = true;
+
+    if ( step.color )
+    {
+        step.layer->set_color(before ? step.color_before : step.color_after);
+    }
+    else
+    {
+        Layer::EditBatch batch(*step.layer);
+        if ( before )
+        {
+            for ( auto it = step.rows.rbegin(); it != step.rows.rend(); ++it )
+                step.layer->set_row(QPoint(it->x, it->y), it->before.data(), it->before.size());
+        }
+        else
+        {
+            for ( const RowDelta& row : step.rows )
+                step.layer->set_row(QPoint(row.x, row.y), row.after.data(), row.after.size());
+        }
+    }
+
+    _applying = false;
+}
+
+} // namespace doc
@@ -0,0 +1,230 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_HISTORY_HPP
+#define ASCEDIT_HISTORY_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+#include <QRect>
+
+#include "layer.hpp"
+
+namespace doc {
+
+/**
+ * \brief Undo/redo stack for the edits on a set of layers
+ *
+ * Steps only store the runs of cells that changed, as the characters
+ * before and after the edit, so memory and the time to undo or redo
+ * depend on the size of the edit and not on the size of the layer.
+ *
+ * Every edit batch on a tracked layer (or every single edit outside
+ * of a batch) becomes a step, as does every color change.
+ * Old contents are captured from Layer::about_to_change and the step
+ * is completed at the following Layer::region_changed.
+ */
+class History : public QObject
+{
+public:
+    /**
+     * \brief Changed cells on a row, '\0' stands for an empty cell
+     */
+    struct RowDelta
+    {
+        int y;
+        int x;
+        std::string before;
+        std::string after;
+    };
+
+    struct Step
+    {
+        Layer* layer = nullptr;
+        std::vector<RowDelta> rows;
+        bool color = false;
+        unsigned color_before = 0;
+        unsigned color_after = 0;
+        int merge_id = -1;
+
+        /**
+         * \brief Approximate number of bytes used by the step
+         */
+        std::size_t memory() const;
+    };
+
+    History() = default;
+
+    /**
+     * \brief Starts recording the edits on \p layer
+     *
+     * Steps on a layer are discarded when the layer is destroyed.
+     */
+    void track(Layer* layer);
+
+    bool can_undo() const
+    {
+        return !_undo.empty();
+    }
+
+    bool can_redo() const
+    {
+        return !_redo.empty();
+    }
+
+    /**
+     * \brief Reverts the last step
+     * \returns Whether there was a step to undo
+     */
+    bool undo();
+
+    /**
+     * \brief Re-applies the last undone step
+     * \returns Whether there was a step to redo
+     */
+    bool redo();
+
+    std::size_t undo_count() const
+    {
+        return _undo.size();
+    }
+
+    std::size_t redo_count() const
+    {
+        return _redo.size();
+    }
+
+    /**
+     * \brief Removes all the steps
+     */
+    void clear();
+
+    /**
+     * \brief Sets the maximum number of bytes used by the steps
+     *
+     * When exceeded the oldest steps are discarded, the latest step
+     * is always kept. 0 means unlimited.
+     */
+    void set_memory_limit(std::size_t bytes);
+
+    std::size_t memory_limit() const
+    {
+        return _memory_limit;
+    }
+
+    /**
+     * \brief Approximate number of bytes used by the steps
+     */
+    std::size_t memory_usage() const
+    {
+        return _memory;
+    }
+
+    /**
+     * \brief Sets the merge id for the following steps
+     *
+     * Consecutive character steps on the same layer with the same
+     * non-negative merge id are joined into one, so a tool can make
+     * a run of keystrokes undo all at once. -1 disables merging.
+     */
+    void set_merge_id(int id)
+    {
+        _merge_id = id;
+    }
+
+    int merge_id() const
+    {
+        return _merge_id;
+    }
+
+    /**
+     * \brief Steps that can be undone, the last one is undone first
+     */
+    const std::deque<Step>& undo_steps() const
+    {
+        return _undo;
+    }
+
+private:
+    /**
+     * \brief Old contents of the cells touched by an edit in progress
+     *
+     * Only the occupied cells are stored, so the cost depends on the
+     * characters in the announced areas rather than on their size.
+     * The areas tell apart cells which were empty from the ones which
+     * haven't been touched yet.
+     */
+    struct Capture
+    {
+        /// Areas up to this tall are stored as column ranges on each row
+        static constexpr int max_row_height = Layer::CharacterMap::tile_size;
+
+        /// Disjoint announced ranges [start, end) by row and by start column
+        std::map<int, std::map<int, int>> rows;
+        /// Announced areas taller than max_row_height
+        std::vector<QRect> rects;
+        /// Characters of the occupied cells before the edit
+        std::map<QPoint, char, Layer::QPointCmp> before;
+
+        /**
+         * \brief Whether \p pos is in an area announced earlier
+         */
+        bool covers(QPoint pos) const;
+
+        void add(const QRect& region);
+
+        /**
+         * \brief Calls function(const QRect&) for each announced area
+         */
+        template<class Function>
+            void for_each_area(Function function) const;
+    };
+
+    void capture(Layer* layer, const QRect& region);
+    void commit(Layer* layer);
+    void commit_all();
+    void push(Step&& step);
+    void forget(Layer* layer);
+    void trim();
+
+    /**
+     * \brief Applies the \p before or the after contents of \p step
+     */
+    void apply(const Step& step, bool before);
+
+    std::deque<Step> _undo;
+    std::vector<Step> _redo;
+    std::unordered_map<Layer*, Capture> _pending;
+    std::unordered_map<Layer*, unsigned> _colors;
+    std::size_t _memory = 0;
+    std::size_t _memory_limit = 0;
+    int _merge_id = -1;
+    /// Prevents the next step from merging into the one before it
+    bool _merge_barrier = false;
+    bool _applying = false;
+};
+
+} // namespace doc
+#endif // ASCEDIT_HISTORY_HPP
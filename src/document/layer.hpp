@@ -21,11 +21,16 @@
 #ifndef ASCEDIT_LAYER_HPP
 #define ASCEDIT_LAYER_HPP
 
-#include <map>
+#include <algorithm>
+#include <ostream>
 #include <string>
 
 #include <QObject>
 #include <QPoint>
+#include <QRect>
+
+#include "text_writer.hpp"
+#include "tile_map.hpp"
 
 namespace doc {
 
@@ -44,8 +49,19 @@ public:
         }
     };
 
-    /// \todo Pick the right mapping type
-    typedef std::map<QPoint, char, QPointCmp> CharacterMap;
+    /**
+     * \brief Character storage, iterates in the order defined by QPointCmp
+     */
+    typedef TileMap<char> CharacterMap;
+
+    /**
+     * \brief Copy of the contents of a layer at some point in time
+     */
+    struct Snapshot
+    {
+        unsigned color;
+        CharacterMap characters;
+    };
 
     Layer(unsigned color)
         : _color(color)
@@ -61,40 +77,208 @@ public:
         return _characters;
     }
 
+    /**
+     * \brief Returns a copy of the contents sharing storage with the layer
+     *
+     * Takes O(number of tiles). The snapshot must be taken on the thread
+     * editing the layer, afterwards it can be read from any thread while
+     * the layer keeps changing.
+     */
+    Snapshot snapshot() const
+    {
+        return Snapshot{_color, _characters};
+    }
+
     void set_char(QPoint pos, char ch)
     {
         // all ascii characters less than plain space are either
         // spaces or special
         if ( ch <= ' ' )
+        {
             remove_char(pos);
-        else
-            _characters[pos] = ch;
+        }
+        else if ( _characters.get(pos) != ch )
+        {
+            emit about_to_change(QRect(pos, QSize(1, 1)));
+            _characters.set(pos, ch);
+            mark_dirty(QRect(pos, QSize(1, 1)));
+        }
+    }
+
+    /**
+     * \brief Sets \p count characters on the row starting from \p start
+     *
+     * Same as calling set_char() for each character, but faster.
+     */
+    void set_row(QPoint start, const char* chars, std::size_t count)
+    {
+        if ( count == 0 )
+            return;
+
+        QRect region(start, QSize(count, 1));
+        emit about_to_change(region);
+        char buffer[CharacterMap::tile_size];
+        while ( count > 0 )
+        {
+            std::size_t span = std::min<std::size_t>(count, sizeof(buffer));
+            for ( std::size_t i = 0; i < span; i++ )
+                buffer[i] = chars[i] <= ' ' ? '\0' : chars[i];
+            _characters.set_row(start, buffer, span);
+            start.rx() += span;
+            chars += span;
+            count -= span;
+        }
+        mark_dirty(region);
+    }
+
+    /**
+     * \brief Sets the characters on row \p y starting from column \p x
+     */
+    void set_row(int y, int x, const std::string& chars)
+    {
+        set_row(QPoint(x, y), chars.data(), chars.size());
+    }
+
+    /**
+     * \brief Sets all the cells in \p rect to \p ch
+     *
+     * Same as calling set_char() for each cell, but it works a tile at a time.
+     */
+    void fill_rect(const QRect& rect, char ch)
+    {
+        if ( ch <= ' ' )
+        {
+            clear_rect(rect);
+        }
+        else if ( !rect.isEmpty() )
+        {
+            emit about_to_change(rect);
+            _characters.fill(rect, ch);
+            mark_dirty(rect);
+        }
+    }
+
+    /**
+     * \brief Removes all the characters in \p rect
+     */
+    void clear_rect(const QRect& rect)
+    {
+        if ( rect.isEmpty() )
+            return;
+
+        emit about_to_change(rect);
+        if ( _characters.erase(rect) )
+            mark_dirty(rect);
+    }
+
+    /**
+     * \brief Copies the characters of \p source moved by \p offset
+     *
+     * Empty cells in \p source don't overwrite characters in this layer.
+     */
+    void blit(const Layer& source, QPoint offset)
+    {
+        // Announced a source tile at a time so sparse sources stay cheap
+        for ( const QRect& tile : source._characters.tile_rects() )
+            emit about_to_change(tile.translated(offset));
+        QRect region = _characters.blit(source._characters, offset);
+        if ( region.isValid() )
+            mark_dirty(region);
     }
 
     void remove_char(QPoint pos)
     {
+        if ( !_characters.get(pos) )
+            return;
+
+        emit about_to_change(QRect(pos, QSize(1, 1)));
         _characters.erase(pos);
+        mark_dirty(QRect(pos, QSize(1, 1)));
     }
 
     char char_at(QPoint pos) const
     {
-        auto it = _characters.find(pos);
-        return it == _characters.end() ? ' ' : it->second;
+        char ch = _characters.get(pos);
+        return ch ? ch : ' ';
     }
 
-    std::string to_string() const
+    /**
+     * \brief Calls function(QPoint, char) for every character in \p rect,
+     * in row-major order within each storage tile
+     *
+     * The cost is proportional to the number of characters in \p rect,
+     * empty tiles and empty rows and columns within a tile are skipped.
+     */
+    template<class Function>
+        void for_each_in(const QRect& rect, Function function) const
     {
-        std::string ret;
-        QPoint last;
-        for ( const auto& pair : _characters )
+        _characters.for_each_in(rect, function);
+    }
+
+    /**
+     * \brief Starts a batch of edits
+     *
+     * Until the matching end_edit(), edits only grow a dirty rectangle
+     * and region_changed() is emitted once at the end with the bounding
+     * rectangle of everything that changed. Batches can be nested.
+     */
+    void begin_edit()
+    {
+        ++_edit_depth;
+    }
+
+    /**
+     * \brief Ends a batch started by begin_edit()
+     */
+    void end_edit()
+    {
+        if ( --_edit_depth == 0 && !_dirty.isEmpty() )
         {
-            if ( last.y() < pair.first.y() )
-                ret += std::string(pair.first.y() - last.y(), '\n');
-            if ( last.x() + 1 < pair.first.x() )
-                ret += std::string(pair.first.x() - last.x() - 1, ' ');
-            ret += pair.second;
+            QRect dirty = _dirty;
+            _dirty = QRect();
+            emit region_changed(dirty);
         }
-        return ret;
+    }
+
+    /**
+     * \brief Calls begin_edit() and end_edit() within a scope
+     */
+    class EditBatch
+    {
+    public:
+        explicit EditBatch(Layer& layer)
+            : _layer(layer)
+        {
+            _layer.begin_edit();
+        }
+
+        ~EditBatch()
+        {
+            _layer.end_edit();
+        }
+
+        EditBatch(const EditBatch&) = delete;
+        EditBatch& operator=(const EditBatch&) = delete;
+
+    private:
+        Layer& _layer;
+    };
+
+    /**
+     * \brief Returns the layer contents as plain text
+     * \see TextLayout for the layout of the output
+     */
+    std::string to_string() const
+    {
+        return TextWriter(_characters).to_string();
+    }
+
+    /**
+     * \brief Streams the layer contents as plain text
+     */
+    void write(std::ostream& stream) const
+    {
+        TextWriter(_characters).write(stream);
     }
 
 public slots:
@@ -110,9 +294,35 @@ public slots:
 signals:
     void color_changed(unsigned color);
 
+    /**
+     * \brief Emitted when characters in \p region may have changed,
+     * once per edit or once per batch
+     * \see begin_edit()
+     */
+    void region_changed(const QRect& region);
+
+    /**
+     * \brief Emitted before characters in \p region are modified
+     *
+     * Receivers can still read the old contents of \p region.
+     * The change is complete at the next region_changed(), which might
+     * never come if the edit turns out not to change anything.
+     */
+    void about_to_change(const QRect& region);
+
 private:
+    void mark_dirty(const QRect& region)
+    {
+        if ( _edit_depth )
+            _dirty |= region;
+        else
+            emit region_changed(region);
+    }
+
     CharacterMap _characters;
     unsigned     _color;
+    int          _edit_depth = 0;
+    QRect        _dirty;
 };
 
 } // namespace doc
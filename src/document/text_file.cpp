@@ -0,0 +1,152 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "text_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace doc {
+
+TextFileReader::TextFileReader(const char* data, std::size_t size)
+    : _data(data), _size(size), _open(true)
+{
+    index_lines();
+}
+
+TextFileReader::TextFileReader(const QString& file_name)
+    : _file(file_name)
+{
+    if ( !_file.open(QIODevice::ReadOnly) )
+        return;
+
+    _size = _file.size();
+    _open = true;
+    // Mapping an empty file fails
+    if ( _size )
+    {
+        _data = reinterpret_cast<const char*>(_file.map(0, _size));
+        if ( !_data )
+        {
+            _open = false;
+            _size = 0;
+            return;
+        }
+    }
+
+    index_lines();
+}
+
+void TextFileReader::index_lines()
+{
+    if ( !_size )
+        return;
+
+    const char* begin = _data;
+    const char* end = _data + _size;
+    _line_starts.push_back(0);
+    // memchr is vectorized by the C library
+    while ( const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin)) )
+    {
+        begin = newline + 1;
+        if ( begin == end )
+            break;
+        // Rows are indexed by int
+        if ( _line_starts.size() == std::size_t(std::numeric_limits<int>::max()) )
+        {
+            _line_starts.clear();
+            _open = false;
+            return;
+        }
+        _line_starts.push_back(begin - _data);
+    }
+    _loaded.assign(_line_starts.size(), false);
+}
+
+int TextFileReader::load_rows(Layer& layer, int first, int last)
+{
+    first = std::max(first, 0);
+    last = std::min(last, row_count());
+
+    Layer::EditBatch batch(layer);
+    int loaded = 0;
+    for ( int y = first; y < last; y++ )
+    {
+        if ( _loaded[y] )
+            continue;
+
+        std::size_t start = _line_starts[y];
+        std::size_t end = y + 1 < row_count() ? _line_starts[y + 1] - 1 : _size;
+        if ( end > start && _data[end - 1] == '\n' )
+            end--;
+        if ( end > start && _data[end - 1] == '\r' )
+            end--;
+
+        layer.set_row(QPoint(0, y), _data + start, end - start);
+        _loaded[y] = true;
+        loaded++;
+    }
+    return loaded;
+}
+
+bool write_text_file(const Layer& layer, const QString& file_name)
+{
+    return write_text_file(layer.characters(), file_name);
+}
+
+bool write_text_file(const Layer::CharacterMap& characters, const QString& file_name)
+{
+    QFile file(file_name);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+        return false;
+
+    static constexpr std::size_t buffer_size = 64 * 1024;
+    std::vector<char> buffer;
+    buffer.reserve(buffer_size);
+    bool ok = true;
+
+    auto write = [&file, &ok](const char* data, std::size_t size) {
+        if ( ok && size )
+            ok = file.write(data, size) == qint64(size);
+    };
+
+    TextWriter(characters).write_lines(
+        [&buffer, &write](const char* data, std::size_t size) {
+            if ( buffer.size() + size > buffer_size )
+            {
+                write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+
+            if ( size >= buffer_size )
+                write(data, size);
+            else
+                buffer.insert(buffer.end(), data, data + size);
+        }
+    );
+    write(buffer.data(), buffer.size());
+
+    return ok;
+}
+
+} // namespace doc
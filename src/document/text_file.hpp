@@ -0,0 +1,125 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_TEXT_FILE_HPP
+#define ASCEDIT_TEXT_FILE_HPP
+
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include "layer.hpp"
+
+namespace doc {
+
+/**
+ * \brief Reads plain text into a Layer straight from a memory-mapped file
+ *
+ * Opening only maps the file and indexes the line starts, rows are
+ * copied into the layer on request so a viewer can materialize just the
+ * visible range. Line y of the text becomes row y of the layer, starting
+ * from column 0; both "\n" and "\r\n" line endings are accepted.
+ */
+class TextFileReader
+{
+public:
+    /**
+     * \brief Reads from memory owned by the caller
+     */
+    TextFileReader(const char* data, std::size_t size);
+
+    /**
+     * \brief Maps \p file_name, check is_open() for errors
+     */
+    explicit TextFileReader(const QString& file_name);
+
+    TextFileReader(const TextFileReader&) = delete;
+    TextFileReader& operator=(const TextFileReader&) = delete;
+
+    /**
+     * \brief Whether the text could be read, texts with more lines
+     * than fit in an int are rejected
+     */
+    bool is_open() const
+    {
+        return _open;
+    }
+
+    /**
+     * \brief Number of lines in the text
+     */
+    int row_count() const
+    {
+        return _line_starts.size();
+    }
+
+    /**
+     * \brief Whether load() or load_rows() already copied row \p y
+     */
+    bool is_loaded(int y) const
+    {
+        return y >= 0 && y < row_count() && _loaded[y];
+    }
+
+    /**
+     * \brief Copies all the rows that haven't been loaded yet
+     */
+    void load(Layer& layer)
+    {
+        load_rows(layer, 0, row_count());
+    }
+
+    /**
+     * \brief Copies the rows in [first, last) that haven't been loaded yet
+     * \returns The number of rows copied
+     */
+    int load_rows(Layer& layer, int first, int last);
+
+private:
+    void index_lines();
+
+    QFile _file;
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+    bool _open = false;
+    std::vector<std::size_t> _line_starts;
+    std::vector<bool> _loaded;
+};
+
+/**
+ * \brief Writes \p layer as plain text to \p file_name
+ *
+ * The text goes through a fixed size buffer, one line at a time, without
+ * building the whole contents in memory.
+ * \see TextLayout for the layout of the output
+ * \returns Whether the file has been written successfully
+ */
+bool write_text_file(const Layer& layer, const QString& file_name);
+
+/**
+ * \brief Writes \p characters as plain text to \p file_name
+ *
+ * Can be called from a background thread on Layer::Snapshot::characters.
+ */
+bool write_text_file(const Layer::CharacterMap& characters, const QString& file_name);
+
+} // namespace doc
+#endif // ASCEDIT_TEXT_FILE_HPP
@@ -0,0 +1,239 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_TEXT_WRITER_HPP
+#define ASCEDIT_TEXT_WRITER_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tile_map.hpp"
+
+namespace doc {
+
+/**
+ * \brief Layout of the text for the cells of a TileMap
+ *
+ * The cell at (x, y) ends up on line y, column x of the output.
+ * The origin is (0, 0) unless there are cells at negative coordinates,
+ * in which case it moves to the top-left of the bounding box.
+ * Lines have no trailing spaces and there is no trailing newline.
+ *
+ * The constructor scans the cells once to find the row extents,
+ * so the exact size of the text is known before writing anything.
+ */
+class TextLayout
+{
+public:
+    struct Row
+    {
+        int y;
+        int last_x;
+    };
+
+    /**
+     * \brief Layout with no cells
+     */
+    TextLayout() = default;
+
+    template<class Map>
+        explicit TextLayout(const Map& cells)
+        : TextLayout(cells, [](const typename Map::value_type&) {})
+    {}
+
+    /**
+     * \brief Builds the layout, calling visit(const Map::value_type&)
+     * for each cell during the scan
+     */
+    template<class Map, class Visit>
+        TextLayout(const Map& cells, Visit visit)
+    {
+        for ( const auto& pair : cells )
+        {
+            if ( pair.first.x() < _origin.x() )
+                _origin.setX(pair.first.x());
+            if ( _rows.empty() || _rows.back().y != pair.first.y() )
+                _rows.push_back({pair.first.y(), pair.first.x()});
+            else
+                _rows.back().last_x = pair.first.x();
+            visit(pair);
+        }
+
+        if ( _rows.empty() )
+            return;
+
+        if ( _rows.front().y < 0 )
+            _origin.setY(_rows.front().y);
+
+        _size = _rows.back().y - _origin.y();
+        for ( const auto& row : _rows )
+            _size += row.last_x - _origin.x() + 1;
+    }
+
+    QPoint origin() const
+    {
+        return _origin;
+    }
+
+    const std::vector<Row>& rows() const
+    {
+        return _rows;
+    }
+
+    /**
+     * \brief Number of characters, padding spaces and newlines
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * \brief Writes the text for \p cells, which must be the ones
+     * the layout was built from
+     *
+     * Padding is written here, \p write_cell is called as
+     * write_cell(char* out, value) with the value of each cell
+     * and returns the pointer past what it has written.
+     * \returns Pointer past the last written byte
+     */
+    template<class Map, class WriteCell>
+        char* write(const Map& cells, char* out, WriteCell write_cell) const
+    {
+        QPoint cursor = _origin;
+        for ( const auto& pair : cells )
+        {
+            if ( pair.first.y() != cursor.y() )
+            {
+                std::size_t lines = pair.first.y() - cursor.y();
+                std::memset(out, '\n', lines);
+                out += lines;
+                cursor = QPoint(_origin.x(), pair.first.y());
+            }
+
+            std::size_t spaces = pair.first.x() - cursor.x();
+            std::memset(out, ' ', spaces);
+            out += spaces;
+            out = write_cell(out, pair.second);
+            cursor.setX(pair.first.x() + 1);
+        }
+        return out;
+    }
+
+private:
+    QPoint _origin;
+    std::vector<Row> _rows;
+    std::size_t _size = 0;
+};
+
+/**
+ * \brief Serializes a character grid as plain text, laid out by TextLayout
+ */
+class TextWriter
+{
+public:
+    typedef TileMap<char> CharacterMap;
+
+    explicit TextWriter(const CharacterMap& characters)
+        : _characters(characters), _layout(characters)
+    {
+    }
+
+    /**
+     * \brief Exact number of bytes produced by write()
+     */
+    std::size_t size() const
+    {
+        return _layout.size();
+    }
+
+    /**
+     * \brief Writes the text to a caller-supplied buffer
+     * \param out Buffer with room for at least size() bytes
+     * \returns Pointer past the last written byte
+     */
+    char* write(char* out) const
+    {
+        return _layout.write(_characters, out, [](char* out, char ch) {
+            *out = ch;
+            return out + 1;
+        });
+    }
+
+    /**
+     * \brief Writes the text one line at a time
+     *
+     * \p output is called as output(const char* data, std::size_t size) with
+     * consecutive pieces of the text, each being either a line without its
+     * newline or the run of newlines before a line. A line is at most as long
+     * as the longest one, a run has one newline per row between the line
+     * and the previous one (or the origin), so it can be longer than any line.
+     */
+    template<class Output>
+        void write_lines(Output output) const
+    {
+        std::string line;
+        auto it = _characters.begin();
+        QPoint origin = _layout.origin();
+        int y = origin.y();
+        for ( const auto& row : _layout.rows() )
+        {
+            if ( row.y != y )
+            {
+                line.assign(row.y - y, '\n');
+                output(line.data(), line.size());
+            }
+            y = row.y;
+
+            line.assign(row.last_x - origin.x() + 1, ' ');
+            for ( ; it != _characters.end() && it->first.y() == row.y; ++it )
+                line[it->first.x() - origin.x()] = it->second;
+            output(line.data(), line.size());
+        }
+    }
+
+    /**
+     * \brief Writes the text to a stream one line at a time
+     */
+    void write(std::ostream& stream) const
+    {
+        write_lines([&stream](const char* data, std::size_t size) {
+            stream.write(data, size);
+        });
+    }
+
+    std::string to_string() const
+    {
+        std::string ret(size(), '\0');
+        if ( !ret.empty() )
+            write(&ret[0]);
+        return ret;
+    }
+
+private:
+    const CharacterMap& _characters;
+    TextLayout _layout;
+};
+
+} // namespace doc
+#endif // ASCEDIT_TEXT_WRITER_HPP
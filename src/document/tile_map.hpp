@@ -0,0 +1,767 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_TILE_MAP_HPP
+#define ASCEDIT_TILE_MAP_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QPoint>
+#include <QRect>
+
+namespace doc {
+
+/**
+ * \brief Sparse 2D grid stored as dense square tiles
+ *
+ * Cells holding a value-initialized \p T are considered empty and tiles
+ * without non-empty cells are not allocated, so lookups are a hash lookup
+ * plus an array index and dense areas take sizeof(T) per cell.
+ *
+ * Iteration visits non-empty cells in row-major order.
+ *
+ * Tiles are shared between copies and copied on write, so copying a map
+ * only copies the tile table. A copy made on the thread modifying the
+ * original can be read from another thread without locking, since shared
+ * tiles are never modified in place.
+ */
+template<class T, int TileBits = 6>
+class TileMap
+{
+    static_assert(TileBits > 0 && TileBits < 8, "Row counters are 8 bit");
+
+public:
+    static constexpr int tile_size = 1 << TileBits;
+    /// 64 bit words in each row of the occupancy masks
+    static constexpr int mask_words = (tile_size + 63) / 64;
+
+    typedef std::pair<QPoint, T> value_type;
+
+    /**
+     * \brief Dense block of tile_size x tile_size cells
+     */
+    struct Tile
+    {
+        std::array<T, tile_size * tile_size> cells{};
+        /// Number of non-empty cells in each row
+        std::array<uint8_t, tile_size> row_count{};
+        /// Number of non-empty cells in the tile
+        int count = 0;
+        /// Bit x of row y is set when the cell at (x, y) is not empty
+        std::array<std::array<uint64_t, mask_words>, tile_size> occupied{};
+
+        const T& at(int x, int y) const
+        {
+            return cells[y * tile_size + x];
+        }
+
+        T& at(int x, int y)
+        {
+            return cells[y * tile_size + x];
+        }
+
+        void set_occupied(int x, int y, bool value)
+        {
+            uint64_t bit = uint64_t(1) << (x % 64);
+            if ( value )
+                occupied[y][x / 64] |= bit;
+            else
+                occupied[y][x / 64] &= ~bit;
+        }
+
+        /**
+         * \brief Sets the occupied bits of row \p y from \p left to \p right inclusive
+         */
+        void set_occupied(int y, int left, int right, bool value)
+        {
+            for ( int word = left / 64; word <= right / 64; word++ )
+            {
+                uint64_t bits = span_mask(word, left, right);
+                if ( value )
+                    occupied[y][word] |= bits;
+                else
+                    occupied[y][word] &= ~bits;
+            }
+        }
+
+        /**
+         * \brief Calls function(int x) for the non-empty cells of row \p y
+         * from \p left to \p right inclusive, in order
+         */
+        template<class Function>
+            void for_each_occupied(int y, int left, int right, Function function) const
+        {
+            for ( int word = left / 64; word <= right / 64; word++ )
+            {
+                uint64_t bits = occupied[y][word] & span_mask(word, left, right);
+                while ( bits )
+                {
+                    function(word * 64 + __builtin_ctzll(bits));
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        /**
+         * \brief First non-empty cell of row \p y at or after \p x,
+         * tile_size if there isn't any
+         */
+        int next_occupied(int y, int x) const
+        {
+            for ( int word = x / 64; word < mask_words; word++ )
+            {
+                uint64_t bits = occupied[y][word] & span_mask(word, x, tile_size - 1);
+                if ( bits )
+                    return word * 64 + __builtin_ctzll(bits);
+            }
+            return tile_size;
+        }
+
+    private:
+        /**
+         * \brief Bits of \p word covering the columns from \p left to \p right
+         */
+        static uint64_t span_mask(int word, int left, int right)
+        {
+            int low = std::max(left - word * 64, 0);
+            int high = std::min(right - word * 64, 63);
+            return (~uint64_t(0) >> (63 - high)) & (~uint64_t(0) << low);
+        }
+    };
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename TileMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef value_type reference;
+
+        struct pointer
+        {
+            value_type value;
+            const value_type* operator->() const { return &value; }
+        };
+
+        const_iterator() = default;
+
+        reference operator*() const
+        {
+            const TileRef& ref = map->_order[tile];
+            return {
+                QPoint(ref.key.x() * tile_size + col, ref.key.y() * tile_size + row),
+                ref.tile->at(col, row)
+            };
+        }
+
+        pointer operator->() const
+        {
+            return {**this};
+        }
+
+        const_iterator& operator++()
+        {
+            ++col;
+            skip_empty();
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator& oth) const
+        {
+            return tile == oth.tile && row == oth.row && col == oth.col;
+        }
+
+        bool operator!=(const const_iterator& oth) const
+        {
+            return !(*this == oth);
+        }
+
+    private:
+        friend class TileMap;
+
+        explicit const_iterator(const TileMap* map)
+            : map(map)
+        {
+            band_end = next_band(0);
+            skip_empty();
+        }
+
+        /**
+         * \brief Index past the last tile sharing the tile row of \p start
+         */
+        std::size_t next_band(std::size_t start) const
+        {
+            std::size_t end = start;
+            while ( end < map->_order.size() &&
+                    map->_order[end].key.y() == map->_order[start].key.y() )
+                ++end;
+            return end;
+        }
+
+        /**
+         * \brief Advances until the iterator points to a non-empty cell
+         *
+         * Tiles within the same tile row are visited one tile row at a time
+         * to preserve row-major order.
+         */
+        void skip_empty()
+        {
+            while ( tile < map->_order.size() )
+            {
+                const Tile& current = *map->_order[tile].tile;
+                if ( current.row_count[row] )
+                {
+                    col = current.next_occupied(row, col);
+                    if ( col < tile_size )
+                        return;
+                }
+
+                col = 0;
+                ++tile;
+                if ( tile == band_end )
+                {
+                    ++row;
+                    if ( row == tile_size )
+                    {
+                        row = 0;
+                        band_begin = band_end;
+                        band_end = next_band(band_begin);
+                    }
+                    tile = band_begin;
+                }
+            }
+
+            // Normalize so all end iterators compare equal
+            row = col = 0;
+        }
+
+        const TileMap* map = nullptr;
+        std::size_t band_begin = 0;
+        std::size_t band_end = 0;
+        std::size_t tile = 0;
+        int row = 0;
+        int col = 0;
+    };
+
+    typedef const_iterator iterator;
+
+    TileMap() = default;
+
+    /**
+     * \brief Shares the tiles of \p oth, O(number of tiles)
+     */
+    TileMap(const TileMap& oth) = default;
+
+    TileMap(TileMap&&) = default;
+
+    TileMap& operator=(const TileMap& oth) = default;
+
+    TileMap& operator=(TileMap&&) = default;
+
+    /**
+     * \brief Returns the value at \p pos or T() if the cell is empty
+     */
+    T get(QPoint pos) const
+    {
+        auto it = _tiles.find(tile_key(pos));
+        if ( it == _tiles.end() )
+            return T();
+        return it->second->at(local(pos.x()), local(pos.y()));
+    }
+
+    /**
+     * \brief Sets the value at \p pos, setting T() clears the cell
+     */
+    void set(QPoint pos, const T& value)
+    {
+        if ( value == T() )
+        {
+            erase(pos);
+            return;
+        }
+
+        Tile& tile = tile_for(tile_key(pos));
+        int x = local(pos.x());
+        int y = local(pos.y());
+        T& cell = tile.at(x, y);
+        if ( cell == T() )
+        {
+            tile.set_occupied(x, y, true);
+            ++tile.row_count[y];
+            ++tile.count;
+            ++_size;
+        }
+        cell = value;
+    }
+
+    /**
+     * \brief Clears the cell at \p pos
+     * \returns Whether the cell was not empty
+     */
+    bool erase(QPoint pos)
+    {
+        QPoint key = tile_key(pos);
+        auto it = _tiles.find(key);
+        if ( it == _tiles.end() )
+            return false;
+
+        int x = local(pos.x());
+        int y = local(pos.y());
+        if ( it->second->at(x, y) == T() )
+            return false;
+
+        Tile& tile = mutable_tile(it);
+        tile.at(x, y) = T();
+        tile.set_occupied(x, y, false);
+        --tile.row_count[y];
+        --_size;
+        if ( --tile.count == 0 )
+            remove_tile(it);
+        return true;
+    }
+
+    /**
+     * \brief Sets \p count consecutive cells starting from \p start
+     * and going right
+     *
+     * Equivalent to calling set() for each value but it only looks up
+     * each tile once.
+     */
+    void set_row(QPoint start, const T* values, std::size_t count)
+    {
+        int y = local(start.y());
+        int tile_y = tile_index(start.y());
+        int x = start.x();
+        while ( count > 0 )
+        {
+            int local_x = local(x);
+            std::size_t span = std::min<std::size_t>(count, tile_size - local_x);
+            QPoint key(tile_index(x), tile_y);
+
+            auto it = _tiles.find(key);
+            if ( it != _tiles.end() ||
+                 std::any_of(values, values + span, [](const T& v) { return v != T(); }) )
+            {
+                Tile& tile = it != _tiles.end() ? mutable_tile(it) : tile_for(key);
+                T* cells = &tile.at(local_x, y);
+                int delta = 0;
+                for ( std::size_t i = 0; i < span; i++ )
+                {
+                    bool occupied = values[i] != T();
+                    delta += occupied - (cells[i] != T());
+                    cells[i] = values[i];
+                    tile.set_occupied(local_x + i, y, occupied);
+                }
+                tile.row_count[y] += delta;
+                tile.count += delta;
+                _size += delta;
+                if ( tile.count == 0 )
+                    remove_tile(_tiles.find(key));
+            }
+
+            x += span;
+            values += span;
+            count -= span;
+        }
+    }
+
+    void clear()
+    {
+        _tiles.clear();
+        _order.clear();
+        _size = 0;
+    }
+
+    /**
+     * \brief Number of non-empty cells
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    /**
+     * \brief Number of allocated tiles
+     */
+    std::size_t tile_count() const
+    {
+        return _tiles.size();
+    }
+
+    /**
+     * \brief Areas covered by the allocated tiles, in row-major order
+     */
+    std::vector<QRect> tile_rects() const
+    {
+        std::vector<QRect> rects;
+        rects.reserve(_order.size());
+        for ( const TileRef& ref : _order )
+            rects.emplace_back(ref.key.x() * tile_size, ref.key.y() * tile_size, tile_size, tile_size);
+        return rects;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this);
+    }
+
+    const_iterator end() const
+    {
+        const_iterator it;
+        it.map = this;
+        it.tile = _order.size();
+        return it;
+    }
+
+    /**
+     * \brief Calls function(QPoint, const T&) for the non-empty cells in \p rect
+     *
+     * Only the allocated tiles overlapping \p rect are visited and within
+     * them only the occupied cells, found from the row bit masks, so the
+     * cost depends on the contents of the area rather than on its size.
+     * Cells are visited in row-major order within each tile, tiles are
+     * visited in row-major order.
+     * The map must not be modified during the call.
+     */
+    template<class Function>
+        void for_each_in(const QRect& rect, Function function) const
+    {
+        for_each_tile_in(rect, [&rect, &function](QPoint origin, const Tile& tile) {
+            int left = std::max(rect.left(), origin.x()) - origin.x();
+            int right = std::min(rect.right(), origin.x() + tile_size - 1) - origin.x();
+            int top = std::max(rect.top(), origin.y()) - origin.y();
+            int bottom = std::min(rect.bottom(), origin.y() + tile_size - 1) - origin.y();
+            for ( int y = top; y <= bottom; y++ )
+            {
+                if ( !tile.row_count[y] )
+                    continue;
+                tile.for_each_occupied(y, left, right, [&tile, &function, origin, y](int x) {
+                    function(QPoint(origin.x() + x, origin.y() + y), tile.at(x, y));
+                });
+            }
+        });
+    }
+
+    /**
+     * \brief Sets all the cells in \p rect to \p value
+     *
+     * Each tile is looked up once and filled a row at a time,
+     * filling with T() clears the area and only visits allocated tiles.
+     */
+    void fill(const QRect& rect, const T& value)
+    {
+        if ( rect.isEmpty() )
+            return;
+
+        if ( value == T() )
+        {
+            erase(rect);
+            return;
+        }
+
+        QPoint first = tile_key(rect.topLeft());
+        QPoint last = tile_key(rect.bottomRight());
+        for ( int tile_y = first.y(); tile_y <= last.y(); tile_y++ )
+        {
+            for ( int tile_x = first.x(); tile_x <= last.x(); tile_x++ )
+            {
+                QPoint origin(tile_x * tile_size, tile_y * tile_size);
+                int left = std::max(rect.left(), origin.x()) - origin.x();
+                int right = std::min(rect.right(), origin.x() + tile_size - 1) - origin.x();
+                int top = std::max(rect.top(), origin.y()) - origin.y();
+                int bottom = std::min(rect.bottom(), origin.y() + tile_size - 1) - origin.y();
+                Tile& tile = tile_for(QPoint(tile_x, tile_y));
+                for ( int y = top; y <= bottom; y++ )
+                {
+                    T* cells = &tile.at(left, y);
+                    int added = 0;
+                    for ( int x = 0; x <= right - left; x++ )
+                    {
+                        added += cells[x] == T();
+                        cells[x] = value;
+                    }
+                    tile.set_occupied(y, left, right, true);
+                    tile.row_count[y] += added;
+                    tile.count += added;
+                    _size += added;
+                }
+            }
+        }
+    }
+
+    /**
+     * \brief Clears all the cells in \p rect
+     * \returns The number of cells that were not empty
+     */
+    std::size_t erase(const QRect& rect)
+    {
+        std::vector<QPoint> keys;
+        for_each_tile_in(rect, [&keys](QPoint origin, const Tile&) {
+            keys.push_back(tile_key(origin));
+        });
+
+        std::size_t erased = 0;
+        for ( QPoint key : keys )
+        {
+            auto it = _tiles.find(key);
+            Tile& tile = mutable_tile(it);
+            QPoint origin(key.x() * tile_size, key.y() * tile_size);
+            int left = std::max(rect.left(), origin.x()) - origin.x();
+            int right = std::min(rect.right(), origin.x() + tile_size - 1) - origin.x();
+            int top = std::max(rect.top(), origin.y()) - origin.y();
+            int bottom = std::min(rect.bottom(), origin.y() + tile_size - 1) - origin.y();
+            for ( int y = top; y <= bottom && tile.count; y++ )
+            {
+                if ( !tile.row_count[y] )
+                    continue;
+                T* cells = &tile.at(left, y);
+                int removed = 0;
+                for ( int x = 0; x <= right - left; x++ )
+                {
+                    removed += cells[x] != T();
+                    cells[x] = T();
+                }
+                tile.set_occupied(y, left, right, false);
+                tile.row_count[y] -= removed;
+                tile.count -= removed;
+                erased += removed;
+            }
+            if ( tile.count == 0 )
+                remove_tile(it);
+        }
+        _size -= erased;
+        return erased;
+    }
+
+    /**
+     * \brief Copies the non-empty cells of \p source moved by \p offset,
+     * cells which are empty in \p source are left unchanged
+     * \returns The bounding rectangle of the copied cells
+     *
+     * Each destination tile is looked up once per source tile row.
+     */
+    QRect blit(const TileMap& source, QPoint offset)
+    {
+        if ( &source == this )
+            return blit(TileMap(source), offset);
+
+        QRect bounds;
+        for ( const TileRef& ref : source._order )
+        {
+            const Tile& from = *ref.tile;
+            QPoint origin(ref.key.x() * tile_size + offset.x(), ref.key.y() * tile_size + offset.y());
+            for ( int y = 0; y < tile_size; y++ )
+            {
+                if ( !from.row_count[y] )
+                    continue;
+
+                int dest_y = origin.y() + y;
+                int first = -1;
+                int last = -1;
+                Tile* tile = nullptr;
+                int tile_x = 0;
+                from.for_each_occupied(y, 0, tile_size - 1, [&](int x) {
+                    const T& value = from.at(x, y);
+                    int dest_x = origin.x() + x;
+                    if ( !tile || tile_index(dest_x) != tile_x )
+                    {
+                        tile_x = tile_index(dest_x);
+                        tile = &tile_for(QPoint(tile_x, tile_index(dest_y)));
+                    }
+
+                    int local_x = local(dest_x);
+                    int local_y = local(dest_y);
+                    T& cell = tile->at(local_x, local_y);
+                    if ( cell == T() )
+                    {
+                        tile->set_occupied(local_x, local_y, true);
+                        ++tile->row_count[local_y];
+                        ++tile->count;
+                        ++_size;
+                    }
+                    cell = value;
+
+                    if ( first == -1 )
+                        first = dest_x;
+                    last = dest_x;
+                });
+                bounds |= QRect(first, dest_y, last - first + 1, 1);
+            }
+        }
+        return bounds;
+    }
+
+    /**
+     * \brief Tile coordinate containing the cell coordinate \p c
+     */
+    static constexpr int tile_index(int c)
+    {
+        return (c >= 0 ? c : c - (tile_size - 1)) / tile_size;
+    }
+
+    /**
+     * \brief Offset of the cell coordinate \p c within its tile
+     */
+    static constexpr int local(int c)
+    {
+        return c - tile_index(c) * tile_size;
+    }
+
+    static constexpr QPoint tile_key(QPoint pos)
+    {
+        return QPoint(tile_index(pos.x()), tile_index(pos.y()));
+    }
+
+private:
+    struct TileHash
+    {
+        std::size_t operator()(const QPoint& key) const
+        {
+            return std::hash<uint64_t>()(
+                (uint64_t(uint32_t(key.y())) << 32) | uint32_t(key.x())
+            );
+        }
+    };
+
+    typedef std::unordered_map<QPoint, std::shared_ptr<Tile>, TileHash> TileTable;
+
+    struct TileRef
+    {
+        QPoint key;
+        const Tile* tile;
+    };
+
+    struct TileCmp
+    {
+        bool operator()(const TileRef& a, const QPoint& b) const
+        {
+            return a.key.y() < b.y() || (a.key.y() == b.y() && a.key.x() < b.x());
+        }
+    };
+
+    /**
+     * \brief Calls function(QPoint origin, const Tile&) for the allocated
+     * tiles overlapping \p rect, in row-major order
+     */
+    template<class Function>
+        void for_each_tile_in(const QRect& rect, Function function) const
+    {
+        if ( rect.isEmpty() )
+            return;
+
+        QPoint first = tile_key(rect.topLeft());
+        QPoint last = tile_key(rect.bottomRight());
+        auto it = std::lower_bound(_order.begin(), _order.end(), first, TileCmp());
+        while ( it != _order.end() && it->key.y() <= last.y() )
+        {
+            // Skip to the first tile in range in this tile row or the next
+            if ( it->key.x() < first.x() )
+            {
+                it = std::lower_bound(it, _order.end(), QPoint(first.x(), it->key.y()), TileCmp());
+                continue;
+            }
+            if ( it->key.x() > last.x() )
+            {
+                it = std::lower_bound(it, _order.end(), QPoint(first.x(), it->key.y() + 1), TileCmp());
+                continue;
+            }
+
+            function(QPoint(it->key.x() * tile_size, it->key.y() * tile_size), *it->tile);
+            ++it;
+        }
+    }
+
+    /**
+     * \brief Returns the tile at \p key for writing, allocating it if needed
+     */
+    Tile& tile_for(QPoint key)
+    {
+        auto it = _tiles.find(key);
+        if ( it != _tiles.end() )
+            return mutable_tile(it);
+
+        std::shared_ptr<Tile>& tile = _tiles[key];
+        tile = std::make_shared<Tile>();
+        _order.insert(
+            std::lower_bound(_order.begin(), _order.end(), key, TileCmp()),
+            TileRef{key, tile.get()}
+        );
+        return *tile;
+    }
+
+    /**
+     * \brief Returns the tile at \p it for writing, copying it if it's shared
+     */
+    Tile& mutable_tile(typename TileTable::iterator it)
+    {
+        if ( it->second.use_count() > 1 )
+        {
+            it->second = std::make_shared<Tile>(*it->second);
+            std::lower_bound(_order.begin(), _order.end(), it->first, TileCmp())->tile = it->second.get();
+        }
+        else
+        {
+            // Pairs with the release of the last other owner,
+            // which might have been reading the tile on another thread
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *it->second;
+    }
+
+    void remove_tile(typename TileTable::iterator it)
+    {
+        _order.erase(std::lower_bound(_order.begin(), _order.end(), it->first, TileCmp()));
+        _tiles.erase(it);
+    }
+
+    TileTable _tiles;
+    /// Allocated tiles, sorted in row-major order
+    std::vector<TileRef> _order;
+    std::size_t _size = 0;
+};
+
+template<class T, int TileBits>
+    constexpr int TileMap<T, TileBits>::tile_size;
+
+template<class T, int TileBits>
+    constexpr int TileMap<T, TileBits>::mask_words;
+
+} // namespace doc
+#endif // ASCEDIT_TILE_MAP_HPP
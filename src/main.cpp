@@ -20,12 +20,27 @@
  *
  */
 #include <QApplication>
-#include <QWidget>
+
+#include "document/text_file.hpp"
+#include "view/canvas.hpp"
 
 int main(int argc, char** argv)
 {
     QApplication app(argc, argv);
-    QWidget window;
+
+    doc::Document document;
+    doc::Layer* layer = document.add_layer(0x000000);
+    if ( argc > 1 )
+    {
+        doc::TextFileReader reader(QString::fromLocal8Bit(argv[1]));
+        if ( reader.is_open() )
+            reader.load(*layer);
+    }
+
+    view::Canvas window;
+    window.setFont(QFont("Monospace"));
+    window.set_document(&document);
+    window.resize(800, 600);
     window.show();
     return app.exec();
 }
@@ -0,0 +1,231 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "canvas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QWheelEvent>
+
+#include "color/cute_color.hpp"
+
+namespace view {
+
+/**
+ * \brief Division rounding towards negative infinity
+ */
+static int floor_div(int a, int b)
+{
+    return (a >= 0 ? a : a - (b - 1)) / b;
+}
+
+Canvas::Canvas(QWidget* parent)
+    : QWidget(parent),
+      _glyphs(new GlyphCache(GlyphCache::render(font())))
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void Canvas::set_document(doc::Document* document)
+{
+    if ( _document )
+        disconnect(_connection);
+
+    _document = document;
+    if ( _document )
+        _connection = connect(_document, &doc::Document::region_changed,
+                              this, &Canvas::document_region_changed);
+    invalidate(rect());
+}
+
+void Canvas::set_background(QRgb background)
+{
+    if ( background != _background )
+    {
+        _background = background;
+        invalidate(rect());
+    }
+}
+
+void Canvas::set_glyphs(GlyphCache glyphs)
+{
+    _glyphs.reset(new GlyphCache(std::move(glyphs)));
+    invalidate(rect());
+}
+
+void Canvas::set_origin(const QPoint& origin)
+{
+    if ( origin != _origin )
+    {
+        _origin = origin;
+        update();
+    }
+}
+
+QRect Canvas::cells_at(const QRect& pixels) const
+{
+    QSize cell = cell_size();
+    QPoint top_left(
+        floor_div(pixels.left() + _origin.x(), cell.width()),
+        floor_div(pixels.top() + _origin.y(), cell.height())
+    );
+    QPoint bottom_right(
+        floor_div(pixels.right() + _origin.x(), cell.width()),
+        floor_div(pixels.bottom() + _origin.y(), cell.height())
+    );
+    return QRect(top_left, bottom_right);
+}
+
+QRect Canvas::pixels_of(const QRect& cells) const
+{
+    QSize cell = cell_size();
+    return QRect(
+        cells.left() * cell.width() - _origin.x(),
+        cells.top() * cell.height() - _origin.y(),
+        cells.width() * cell.width(),
+        cells.height() * cell.height()
+    );
+}
+
+void Canvas::paintEvent(QPaintEvent* event)
+{
+    scroll_buffer();
+
+    // Atlases are only looked up while rendering, so they can go here
+    _glyphs->trim();
+    for ( const QRect& rect : _dirty )
+        render(rect);
+    _dirty = QRegion();
+
+    QPainter painter(this);
+    for ( const QRect& rect : event->region() )
+        painter.drawImage(rect, _buffer, rect);
+}
+
+void Canvas::resizeEvent(QResizeEvent*)
+{
+    _buffer = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+    _buffer_origin = _origin;
+    _dirty = rect();
+}
+
+void Canvas::wheelEvent(QWheelEvent* event)
+{
+    QPoint delta = event->pixelDelta();
+    if ( delta.isNull() )
+        delta = event->angleDelta() / 2;
+    if ( event->modifiers() & Qt::ShiftModifier )
+        delta = QPoint(delta.y(), delta.x());
+    set_origin(_origin - delta);
+    event->accept();
+}
+
+void Canvas::changeEvent(QEvent* event)
+{
+    if ( event->type() == QEvent::FontChange )
+    {
+        _glyphs.reset(new GlyphCache(GlyphCache::render(font())));
+        invalidate(rect());
+    }
+    QWidget::changeEvent(event);
+}
+
+void Canvas::document_region_changed(const QRect& cells)
+{
+    invalidate(pixels_of(cells) & rect());
+}
+
+void Canvas::invalidate(const QRegion& pixels)
+{
+    if ( pixels.isEmpty() )
+        return;
+    _dirty |= pixels;
+    update(pixels);
+}
+
+void Canvas::scroll_buffer()
+{
+    QPoint delta = _buffer_origin - _origin;
+    _buffer_origin = _origin;
+    if ( delta.isNull() || _buffer.isNull() )
+        return;
+
+    QRect kept = _buffer.rect() & _buffer.rect().translated(delta);
+    if ( kept.isEmpty() )
+    {
+        _dirty = rect();
+        return;
+    }
+
+    // Rows are moved in the order which doesn't overwrite rows still to move
+    QRect source = kept.translated(-delta);
+    std::size_t bytes = kept.width() * sizeof(QRgb);
+    int height = kept.height();
+    for ( int i = 0; i < height; i++ )
+    {
+        int row = delta.y() > 0 ? height - 1 - i : i;
+        const uchar* from = _buffer.constScanLine(source.top() + row) + source.left() * sizeof(QRgb);
+        uchar* to = _buffer.scanLine(kept.top() + row) + kept.left() * sizeof(QRgb);
+        std::memmove(to, from, bytes);
+    }
+
+    _dirty = (_dirty.translated(delta) & kept) | (QRegion(rect()) - kept);
+}
+
+void Canvas::render(const QRect& pixels)
+{
+    QRect area = pixels & _buffer.rect();
+    if ( area.isEmpty() )
+        return;
+
+    QRgb background = qPremultiply(_background);
+    for ( int y = area.top(); y <= area.bottom(); y++ )
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(_buffer.scanLine(y));
+        std::fill(line + area.left(), line + area.right() + 1, background);
+    }
+
+    if ( !_document )
+        return;
+
+    // Looked up once per layer, cells are copied straight from the atlas
+    std::vector<const QImage*> atlases(_document->layer_count(), nullptr);
+    QSize cell = cell_size();
+    _document->composite().for_each_in(cells_at(area),
+        [this, &atlases, &area, cell](QPoint pos, const doc::CompositeCell& composite) {
+            const QImage*& atlas = atlases[composite.layer];
+            if ( !atlas )
+            {
+                color::Color ink(color::repr::RGB_int24(_document->layer(composite.layer)->color()));
+                atlas = &_glyphs->atlas(color::to_qrgb(ink), _background);
+            }
+            QPoint top_left(pos.x() * cell.width() - _origin.x(), pos.y() * cell.height() - _origin.y());
+            _glyphs->draw(_buffer, top_left, composite.character, *atlas, area);
+        }
+    );
+}
+
+} // namespace view
@@ -0,0 +1,145 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_VIEW_CANVAS_HPP
+#define ASCEDIT_VIEW_CANVAS_HPP
+
+#include <memory>
+
+#include <QImage>
+#include <QMetaObject>
+#include <QRegion>
+#include <QWidget>
+
+#include "document/document.hpp"
+#include "glyph_cache.hpp"
+
+namespace view {
+
+/**
+ * \brief Widget showing a doc::Document
+ *
+ * Cells are drawn by copying glyphs from a GlyphCache into a back buffer
+ * the size of the widget. Only the areas of the buffer which are out of
+ * date are redrawn: the ones changed in the document and, when scrolling,
+ * the ones which have just become visible, the rest is moved in place.
+ */
+class Canvas : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit Canvas(QWidget* parent = nullptr);
+
+    doc::Document* document() const
+    {
+        return _document;
+    }
+
+    /**
+     * \brief Sets the document to show, not owned by the canvas
+     */
+    void set_document(doc::Document* document);
+
+    /**
+     * \brief Document pixel shown at the top-left corner of the widget
+     */
+    QPoint origin() const
+    {
+        return _origin;
+    }
+
+    QRgb background() const
+    {
+        return _background;
+    }
+
+    void set_background(QRgb background);
+
+    /**
+     * \brief Size in pixels of a cell, depends on the widget font
+     */
+    QSize cell_size() const
+    {
+        return _glyphs->cell_size();
+    }
+
+    /**
+     * \brief Replaces the glyphs rendered from the widget font,
+     * until the font changes
+     */
+    void set_glyphs(GlyphCache glyphs);
+
+    /**
+     * \brief Widget areas which will be redrawn on the next paint event
+     */
+    const QRegion& dirty_region() const
+    {
+        return _dirty;
+    }
+
+    /**
+     * \brief Cells overlapping the widget area \p pixels
+     */
+    QRect cells_at(const QRect& pixels) const;
+
+    /**
+     * \brief Widget area covered by \p cells
+     */
+    QRect pixels_of(const QRect& cells) const;
+
+public slots:
+    void set_origin(const QPoint& origin);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void changeEvent(QEvent* event) override;
+
+private:
+    void document_region_changed(const QRect& cells);
+
+    /**
+     * \brief Moves the buffer contents to match the current origin
+     */
+    void scroll_buffer();
+
+    /**
+     * \brief Redraws the buffer area \p pixels
+     */
+    void render(const QRect& pixels);
+
+    void invalidate(const QRegion& pixels);
+
+    doc::Document* _document = nullptr;
+    QMetaObject::Connection _connection;
+    std::unique_ptr<GlyphCache> _glyphs;
+    QRgb _background = 0xffffffff;
+    QPoint _origin;
+    /// Origin the contents of _buffer correspond to
+    QPoint _buffer_origin;
+    QImage _buffer;
+    /// Areas of the buffer which need to be redrawn
+    QRegion _dirty;
+};
+
+} // namespace view
+#endif // ASCEDIT_VIEW_CANVAS_HPP
@@ -0,0 +1,157 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "glyph_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QFontMetrics>
+#include <QPainter>
+
+namespace view {
+
+constexpr int GlyphCache::glyph_count;
+constexpr std::size_t GlyphCache::max_atlases;
+
+GlyphCache::GlyphCache(QSize cell_size, std::vector<uint8_t> coverage)
+    : _cell_size(cell_size), _coverage(std::move(coverage))
+{
+    _coverage.resize(glyph_count * cell_size.width() * cell_size.height());
+}
+
+GlyphCache GlyphCache::render(const QFont& font)
+{
+    QFontMetrics metrics(font);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    int width = metrics.horizontalAdvance('M');
+#else
+    int width = metrics.width('M');
+#endif
+    QSize cell_size(std::max(1, width), std::max(1, metrics.height()));
+    QImage image(cell_size, QImage::Format_RGB32);
+    std::size_t area = cell_size.width() * cell_size.height();
+    std::vector<uint8_t> coverage(glyph_count * area, 0);
+
+    for ( int index = 1; index < glyph_count; index++ )
+    {
+        char ch = ' ' + index;
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setFont(font);
+        painter.setPen(Qt::black);
+        painter.drawText(0, metrics.ascent(), QString(QChar(ch)));
+        painter.end();
+
+        uint8_t* mask = coverage.data() + index * area;
+        for ( int y = 0; y < cell_size.height(); y++ )
+        {
+            const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for ( int x = 0; x < cell_size.width(); x++ )
+                mask[y * cell_size.width() + x] = 255 - qGray(line[x]);
+        }
+    }
+
+    return GlyphCache(cell_size, std::move(coverage));
+}
+
+const QImage& GlyphCache::atlas(QRgb ink, QRgb background)
+{
+    uint64_t key = (uint64_t(ink) << 32) | background;
+    auto it = _atlases.find(key);
+    if ( it != _atlases.end() )
+    {
+        it->second.last_use = ++_uses;
+        return it->second.image;
+    }
+
+    // Blending with a constant alpha, so the colors can be premultiplied first
+    QRgb ink_pm = qPremultiply(ink);
+    QRgb background_pm = qPremultiply(background);
+    QRgb lookup[256];
+    for ( int alpha = 0; alpha < 256; alpha++ )
+    {
+        auto mix = [alpha](int from, int to) {
+            return (from * (255 - alpha) + to * alpha + 127) / 255;
+        };
+        lookup[alpha] = qRgba(
+            mix(qRed(background_pm), qRed(ink_pm)),
+            mix(qGreen(background_pm), qGreen(ink_pm)),
+            mix(qBlue(background_pm), qBlue(ink_pm)),
+            mix(qAlpha(background_pm), qAlpha(ink_pm))
+        );
+    }
+
+    int width = _cell_size.width();
+    QImage image(width, _cell_size.height() * glyph_count, QImage::Format_ARGB32_Premultiplied);
+    const uint8_t* mask = _coverage.data();
+    for ( int y = 0; y < image.height(); y++ )
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for ( int x = 0; x < width; x++ )
+            line[x] = lookup[*mask++];
+    }
+
+    return _atlases.emplace(key, Atlas{std::move(image), ++_uses}).first->second.image;
+}
+
+void GlyphCache::trim(std::size_t max)
+{
+    if ( _atlases.size() <= max )
+        return;
+
+    // Uses are unique, so this keeps exactly the max most recent ones
+    std::vector<uint64_t> uses;
+    uses.reserve(_atlases.size());
+    for ( const auto& atlas : _atlases )
+        uses.push_back(atlas.second.last_use);
+    auto oldest_kept = uses.end() - max;
+    std::nth_element(uses.begin(), oldest_kept, uses.end());
+    uint64_t threshold = max ? *oldest_kept : _uses + 1;
+
+    for ( auto it = _atlases.begin(); it != _atlases.end(); )
+    {
+        if ( it->second.last_use < threshold )
+            it = _atlases.erase(it);
+        else
+            ++it;
+    }
+}
+
+void GlyphCache::draw(QImage& target, QPoint pos, char ch, const QImage& atlas, const QRect& clip) const
+{
+    QRect area = QRect(pos, _cell_size) & clip & target.rect();
+    if ( area.isEmpty() )
+        return;
+
+    int source_x = area.left() - pos.x();
+    int source_y = index(ch) * _cell_size.height() + area.top() - pos.y();
+    std::size_t bytes = area.width() * sizeof(QRgb);
+    for ( int y = 0; y < area.height(); y++ )
+    {
+        const QRgb* from = reinterpret_cast<const QRgb*>(atlas.constScanLine(source_y + y)) + source_x;
+        QRgb* to = reinterpret_cast<QRgb*>(target.scanLine(area.top() + y)) + area.left();
+        std::memcpy(to, from, bytes);
+    }
+}
+
+} // namespace view
@@ -0,0 +1,121 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASCEDIT_VIEW_GLYPH_CACHE_HPP
+#define ASCEDIT_VIEW_GLYPH_CACHE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <QFont>
+#include <QImage>
+#include <QRect>
+
+namespace view {
+
+/**
+ * \brief Pre-rendered glyphs of a font, for drawing cells by copying pixels
+ *
+ * The font is rasterized once as coverage masks. For every ink and
+ * background pair an atlas image is built on first use with the glyphs
+ * already blended, so drawing a cell is just a copy of its rows.
+ */
+class GlyphCache
+{
+public:
+    /// Printable ASCII, glyph 0 is the space
+    static constexpr int glyph_count = 0x7f - ' ';
+    /// Number of atlases kept by trim()
+    static constexpr std::size_t max_atlases = 64;
+
+    /**
+     * \brief Builds the cache from pre-rendered coverage masks
+     * \param cell_size Size of a glyph in pixels
+     * \param coverage  glyph_count masks of cell_size pixels, in character
+     *                  order, with 0 for background and 255 for ink
+     */
+    GlyphCache(QSize cell_size, std::vector<uint8_t> coverage);
+
+    /**
+     * \brief Renders the printable characters using \p font
+     */
+    static GlyphCache render(const QFont& font);
+
+    QSize cell_size() const
+    {
+        return _cell_size;
+    }
+
+    /**
+     * \brief Index of the glyph for \p ch, unprintable characters map to the space
+     */
+    static int index(char ch)
+    {
+        return ch > ' ' && ch < 0x7f ? ch - ' ' : 0;
+    }
+
+    /**
+     * \brief Glyphs drawn in \p ink over \p background
+     *
+     * The glyphs are stacked vertically in character order,
+     * the image is in QImage::Format_ARGB32_Premultiplied.
+     * References stay valid until the next call to trim().
+     */
+    const QImage& atlas(QRgb ink, QRgb background);
+
+    /**
+     * \brief Number of atlases currently built
+     */
+    std::size_t atlas_count() const
+    {
+        return _atlases.size();
+    }
+
+    /**
+     * \brief Drops the least recently used atlases, keeping at most \p max
+     *
+     * Invalidates the references returned by atlas().
+     */
+    void trim(std::size_t max = max_atlases);
+
+    /**
+     * \brief Copies the glyph for \p ch from \p atlas to \p target,
+     * with its top-left corner at \p pos and clipped to \p clip
+     * \pre \p target is in QImage::Format_ARGB32_Premultiplied
+     */
+    void draw(QImage& target, QPoint pos, char ch, const QImage& atlas, const QRect& clip) const;
+
+private:
+    struct Atlas
+    {
+        QImage image;
+        /// Value of _uses when the atlas was last requested
+        uint64_t last_use;
+    };
+
+    QSize _cell_size;
+    std::vector<uint8_t> _coverage;
+    std::unordered_map<uint64_t, Atlas> _atlases;
+    uint64_t _uses = 0;
+};
+
+} // namespace view
+#endif // ASCEDIT_VIEW_GLYPH_CACHE_HPP
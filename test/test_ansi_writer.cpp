@@ -0,0 +1,135 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Ansi_Writer
+
+#include <boost/test/unit_test.hpp>
+
+#include "document/ansi_writer.hpp"
+#include "document/text_writer.hpp"
+#include "color/palette.hpp"
+
+using namespace doc;
+
+/**
+ * \brief Removes the escape sequences from \p text
+ */
+static std::string strip_sgr(const std::string& text)
+{
+    std::string stripped;
+    for ( std::size_t i = 0; i < text.size(); i++ )
+    {
+        if ( text[i] == '\x1b' )
+            i = text.find('m', i);
+        else
+            stripped += text[i];
+    }
+    return stripped;
+}
+
+BOOST_AUTO_TEST_CASE( test_empty )
+{
+    Document document;
+    document.add_layer(0xff0000);
+    AnsiWriter writer(document, AnsiColors::TrueColor);
+    BOOST_CHECK_EQUAL( writer.size(), 0u );
+    BOOST_CHECK_EQUAL( writer.to_string(), "" );
+}
+
+BOOST_AUTO_TEST_CASE( test_true_color )
+{
+    Document document;
+    Layer* red = document.add_layer(0xff0000);
+    Layer* blue = document.add_layer(0x0000ff);
+    red->set_row(QPoint(0, 0), "ab", 2);
+    blue->set_char({3, 0}, 'c');
+    red->set_char({1, 1}, 'd');
+    blue->set_char({2, 1}, 'e');
+
+    AnsiWriter writer(document, AnsiColors::TrueColor);
+    std::string expected =
+        "\x1b[38;2;255;0;0mab \x1b[38;2;0;0;255mc\n"
+        " \x1b[38;2;255;0;0md\x1b[38;2;0;0;255me\x1b[0m";
+    BOOST_CHECK_EQUAL( writer.to_string(), expected );
+    BOOST_CHECK_EQUAL( writer.size(), expected.size() );
+}
+
+BOOST_AUTO_TEST_CASE( test_coalesce )
+{
+    Document document;
+    Layer* first = document.add_layer(0x123456);
+    Layer* second = document.add_layer(0x123456);
+    Layer* third = document.add_layer(0x123457);
+    first->set_char({0, 0}, 'a');
+    second->set_char({1, 0}, 'b');
+    third->set_char({2, 0}, 'c');
+
+    // Different in true color, the same xterm entry
+    BOOST_CHECK_EQUAL(
+        AnsiWriter(document, AnsiColors::TrueColor).to_string(),
+        "\x1b[38;2;18;52;86mab\x1b[38;2;18;52;87mc\x1b[0m"
+    );
+    int index = color::xterm256_nearest(color::Color(0x12, 0x34, 0x56));
+    BOOST_CHECK_EQUAL(
+        AnsiWriter(document, AnsiColors::Xterm256).to_string(),
+        "\x1b[38;5;" + std::to_string(index) + "mabc\x1b[0m"
+    );
+}
+
+BOOST_AUTO_TEST_CASE( test_layout )
+{
+    Document document;
+    Layer* layer = document.add_layer(0x00ff00);
+    layer->set_char({-2, -1}, 'a');
+    layer->set_char({3, 2}, 'b');
+    layer->set_char({70, 4}, 'c');
+    layer->set_char({1, 130}, 'd');
+
+    for ( AnsiColors colors : {AnsiColors::Xterm256, AnsiColors::TrueColor} )
+    {
+        AnsiWriter writer(document, colors);
+        std::string text = writer.to_string();
+        BOOST_CHECK_EQUAL( text.size(), writer.size() );
+        BOOST_CHECK_EQUAL( strip_sgr(text), TextWriter(layer->characters()).to_string() );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_reuse_buffer )
+{
+    Document document;
+    Layer* layer = document.add_layer(0xffffff);
+    layer->fill_rect(QRect(0, 0, 80, 25), '#');
+
+    std::string buffer;
+    AnsiWriter(document, AnsiColors::Xterm256).write(buffer);
+    BOOST_CHECK_EQUAL( buffer, "\x1b[38;5;231m" + TextWriter(layer->characters()).to_string() + "\x1b[0m" );
+    const char* data = buffer.data();
+
+    layer->set_char({0, 0}, '@');
+    AnsiWriter(document, AnsiColors::Xterm256).write(buffer);
+    BOOST_CHECK_EQUAL( buffer[11], '@' );
+    BOOST_CHECK( buffer.data() == data );
+}
+
+BOOST_AUTO_TEST_CASE( test_xterm256_nearest )
+{
+    for ( int i = 16; i < 256; i++ )
+        BOOST_CHECK_EQUAL( color::xterm256_nearest(color::xterm256_color(i)), i );
+    BOOST_CHECK_EQUAL( color::xterm256_nearest(color::Color(250, 5, 5)), 196 );
+}
@@ -0,0 +1,288 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Binary_Format
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <random>
+#include <thread>
+
+#include "document/binary_format.hpp"
+
+using namespace doc;
+
+BOOST_AUTO_TEST_CASE( test_round_trip )
+{
+    Layer first(0x123456);
+    first.set_char(QPoint(-5, -3), 'a');
+    std::string line = "abbbbbbbbcd    efgggg";
+    first.set_row(QPoint(10, 2), line.data(), line.size());
+    first.set_char(QPoint(100000, 2), 'z');
+
+    Layer second(7);
+    for ( int y = 0; y < 300; y++ )
+        for ( int x = 0; x < 200; x += 1 + y % 3 )
+            second.set_char(QPoint(x, y), 'A' + (x / 7 + y) % 26);
+
+    Layer empty(3);
+
+    auto data = binary::encode({&first, &second, &empty});
+    BOOST_CHECK_EQUAL( data.size() % 8, 0u );
+    binary::DocumentView view(data.data(), data.size());
+    BOOST_REQUIRE( view.is_valid() );
+    BOOST_REQUIRE_EQUAL( view.layer_count(), 3u );
+
+    BOOST_CHECK_EQUAL( view.layer(0).color(), 0x123456u );
+    BOOST_CHECK_EQUAL( view.layer(0).row_count(), 2u );
+    BOOST_CHECK_EQUAL( view.layer(0).row(1).y, 2 );
+    BOOST_CHECK_EQUAL( view.layer(0).row(1).x, 10 );
+    BOOST_CHECK_EQUAL( view.layer(1).color(), 7u );
+    BOOST_CHECK_EQUAL( view.layer(1).row_count(), 300u );
+    BOOST_CHECK_EQUAL( view.layer(2).row_count(), 0u );
+
+    Layer loaded(0);
+    BOOST_CHECK( view.layer(0).load(loaded) );
+    BOOST_CHECK( loaded.to_string() == first.to_string() );
+    BOOST_CHECK_EQUAL( loaded.characters().size(), first.characters().size() );
+
+    Layer loaded_second(0);
+    BOOST_CHECK( view.layer(1).load(loaded_second) );
+    BOOST_CHECK( loaded_second.to_string() == second.to_string() );
+
+    Layer loaded_empty(0);
+    BOOST_CHECK( view.layer(2).load(loaded_empty) );
+    BOOST_CHECK( loaded_empty.characters().empty() );
+}
+
+BOOST_AUTO_TEST_CASE( test_load_rows )
+{
+    Layer layer(0);
+    for ( int y = 0; y < 10; y++ )
+        layer.set_char(QPoint(y, y * 2), '#');
+
+    auto data = binary::encode({&layer});
+    binary::DocumentView view(data.data(), data.size());
+    BOOST_REQUIRE( view.is_valid() );
+
+    Layer loaded(0);
+    BOOST_CHECK( view.layer(0).load_rows(loaded, 3, 9) );
+    BOOST_CHECK_EQUAL( loaded.characters().size(), 3u );
+    BOOST_CHECK_EQUAL( loaded.char_at(QPoint(2, 4)), '#' );
+    BOOST_CHECK_EQUAL( loaded.char_at(QPoint(4, 8)), '#' );
+    BOOST_CHECK_EQUAL( loaded.char_at(QPoint(1, 2)), ' ' );
+}
+
+BOOST_AUTO_TEST_CASE( test_compact )
+{
+    // Runs and empty space take a few bytes
+    Layer layer(0);
+    std::string line(1000, '=');
+    for ( int y = 0; y < 1000; y += 100 )
+        layer.set_row(QPoint(0, y), line.data(), line.size());
+
+    auto data = binary::encode({&layer});
+    BOOST_CHECK_LT( data.size(), 400u );
+    BOOST_CHECK_GT( layer.to_string().size(), 10000u );
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid )
+{
+    Layer layer(0);
+    layer.set_char(QPoint(0, 0), 'x');
+    auto data = binary::encode({&layer});
+
+    BOOST_CHECK( !binary::DocumentView(data.data(), 10).is_valid() );
+    BOOST_CHECK( !binary::DocumentView(data.data(), data.size() - 8).is_valid() );
+
+    auto bad_magic = data;
+    bad_magic[0] = 'X';
+    BOOST_CHECK( !binary::DocumentView(bad_magic.data(), bad_magic.size()).is_valid() );
+
+    auto bad_version = data;
+    bad_version[4] = 2;
+    BOOST_CHECK( !binary::DocumentView(bad_version.data(), bad_version.size()).is_valid() );
+
+    // Random garbage never reads out of bounds
+    std::mt19937 random(0);
+    for ( int i = 0; i < 1000; i++ )
+    {
+        auto corrupt = data;
+        corrupt[random() % corrupt.size()] = random();
+        binary::DocumentView view(corrupt.data(), corrupt.size());
+        Layer loaded(0);
+        for ( std::size_t j = 0; j < view.layer_count(); j++ )
+            view.layer(j).load(loaded);
+    }
+}
+
+/**
+ * \brief Document with a single row at (\p x, 0) made of \p spans
+ */
+static std::vector<char> single_row(int x, const std::vector<char>& spans)
+{
+    std::vector<char> data(72 + spans.size() + 8, 0);
+    auto put = [&data](std::size_t offset, uint64_t value, int size) {
+        for ( int i = 0; i < size; i++ )
+            data[offset + i] = char(value >> (8 * i));
+    };
+    std::copy(binary::magic, binary::magic + 4, data.begin());
+    put(4, binary::version, 2);
+    put(8, 1, 4);
+    // Layer entry
+    put(20, 1, 4);
+    put(24, 48, 8);
+    put(32, 72, 8);
+    put(40, spans.size(), 8);
+    // Row entry
+    put(52, uint32_t(x), 4);
+    put(56, spans.size(), 4);
+    std::copy(spans.begin(), spans.end(), data.begin() + 72);
+    return data;
+}
+
+/**
+ * \brief Appends \p value as an unsigned LEB128 varint
+ */
+static void varint(std::vector<char>& out, uint64_t value)
+{
+    for ( ; value >= 0x80; value >>= 7 )
+        out.push_back(char(value | 0x80));
+    out.push_back(char(value));
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid_gap )
+{
+    std::vector<char> spans;
+    varint(spans, 3);
+    varint(spans, 1 << 1);
+    spans.push_back('x');
+    auto data = single_row(100, spans);
+    binary::DocumentView view(data.data(), data.size());
+    BOOST_REQUIRE( view.is_valid() );
+    Layer loaded(0);
+    BOOST_CHECK( view.layer(0).load(loaded) );
+    BOOST_CHECK_EQUAL( loaded.char_at(QPoint(103, 0)), 'x' );
+
+    // Would wrap around to x = 50
+    spans.clear();
+    varint(spans, uint64_t(-50));
+    varint(spans, 1 << 1);
+    spans.push_back('x');
+    data = single_row(100, spans);
+    view = binary::DocumentView(data.data(), data.size());
+    BOOST_REQUIRE( view.is_valid() );
+    Layer wrapped(0);
+    BOOST_CHECK( !view.layer(0).load(wrapped) );
+    BOOST_CHECK( wrapped.characters().empty() );
+
+    // Past the last column
+    spans.clear();
+    varint(spans, uint64_t(std::numeric_limits<int>::max()) - 99);
+    varint(spans, 1 << 1);
+    spans.push_back('x');
+    data = single_row(100, spans);
+    view = binary::DocumentView(data.data(), data.size());
+    BOOST_CHECK( !view.layer(0).load(wrapped) );
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid_unchanged )
+{
+    // A valid span followed by a truncated varint
+    std::vector<char> spans;
+    varint(spans, 0);
+    varint(spans, 3 << 1);
+    spans.insert(spans.end(), {'a', 'b', 'c', char(0x80)});
+    auto data = single_row(0, spans);
+    binary::DocumentView view(data.data(), data.size());
+    BOOST_REQUIRE( view.is_valid() );
+
+    Layer loaded(0);
+    loaded.set_char(QPoint(1, 0), 'z');
+    int changes = 0;
+    QObject::connect(&loaded, &Layer::region_changed, [&changes](const QRect&) {
+        changes++;
+    });
+    BOOST_CHECK( !view.layer(0).load(loaded) );
+    BOOST_CHECK_EQUAL( loaded.to_string(), " z" );
+    BOOST_CHECK_EQUAL( changes, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_unsorted_rows )
+{
+    Layer layer(0);
+    layer.set_char(QPoint(0, 0), 'a');
+    layer.set_char(QPoint(0, 5), 'b');
+    auto data = binary::encode({&layer});
+    BOOST_REQUIRE( binary::DocumentView(data.data(), data.size()).is_valid() );
+
+    // Swaps the y of the two rows
+    std::size_t rows = binary::detail::read_le<uint64_t>(data.data() + binary::header_size + 8);
+    std::swap_ranges(data.begin() + rows, data.begin() + rows + 4,
+                     data.begin() + rows + binary::row_entry_size);
+    BOOST_CHECK( !binary::DocumentView(data.data(), data.size()).is_valid() );
+
+    // Duplicate rows
+    std::copy(data.begin() + rows, data.begin() + rows + 4,
+              data.begin() + rows + binary::row_entry_size);
+    BOOST_CHECK( !binary::DocumentView(data.data(), data.size()).is_valid() );
+}
+
+BOOST_AUTO_TEST_CASE( test_file )
+{
+    const char* file_name = "test_binary_format.ascd";
+    Layer layer(5);
+    layer.set_char(QPoint(1, 1), 'x');
+    BOOST_REQUIRE( binary::write_file({&layer}, file_name) );
+
+    {
+        binary::MappedDocument document(file_name);
+        BOOST_REQUIRE( document.is_valid() );
+        BOOST_CHECK_EQUAL( document.view().layer(0).color(), 5u );
+        Layer loaded(0);
+        BOOST_CHECK( document.view().layer(0).load(loaded) );
+        BOOST_CHECK_EQUAL( loaded.to_string(), "\n x" );
+    }
+
+    std::remove(file_name);
+    BOOST_CHECK( !binary::MappedDocument(file_name).is_valid() );
+}
+
+BOOST_AUTO_TEST_CASE( test_encode_snapshot )
+{
+    Layer layer(9);
+    for ( int y = 0; y < 500; y++ )
+        layer.fill_rect(QRect(0, y, 300, 1), 'a' + y % 26);
+    std::vector<char> expected = binary::encode({&layer});
+
+    // The snapshot stays the same while the layer keeps changing
+    std::vector<Layer::Snapshot> snapshots{layer.snapshot()};
+    std::vector<char> encoded;
+    std::thread writer([&snapshots, &encoded] {
+        encoded = binary::encode(snapshots);
+    });
+    for ( int i = 0; i < 1000; i++ )
+        layer.set_char(QPoint(i % 300, i % 500), '#');
+    layer.set_color(10);
+    layer.clear_rect(QRect(0, 0, 100, 100));
+    writer.join();
+
+    BOOST_CHECK( encoded == expected );
+}
@@ -0,0 +1,147 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Blend
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+#include "color/blend.hpp"
+
+using namespace color;
+
+/**
+ * \brief Random colors, the size is odd to exercise the scalar tails
+ */
+static std::vector<PackedColor> random_colors(unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<PackedColor> colors;
+    for ( int i = 0; i < 1027; i++ )
+        colors.emplace_back(channel(random), channel(random), channel(random), channel(random));
+    return colors;
+}
+
+static bool close(const PackedColor& a, const Color& b)
+{
+    auto near = [](int x, int y) { return std::abs(x - y) <= 1; };
+    return near(a.red(), b.red()) && near(a.green(), b.green()) &&
+           near(a.blue(), b.blue()) && near(a.alpha(), b.alpha());
+}
+
+template<class Repr, class Function>
+    static void check_blend(Function function)
+{
+    auto a = random_colors(1);
+    auto b = random_colors(2);
+    std::vector<PackedColor> output(a.size());
+
+    for ( float factor : {0.f, 0.25f, 0.5f, 0.9f, 1.f} )
+    {
+        function(a.data(), b.data(), output.data(), a.size(), factor);
+        for ( std::size_t i = 0; i < a.size(); i++ )
+        {
+            Color expected = Color(a[i]).blend<Repr>(Color(b[i]), factor);
+            BOOST_CHECK_MESSAGE( close(output[i], expected),
+                Color(output[i]) << " != " << expected << " at " << i << " factor " << factor );
+        }
+    }
+
+    // In place
+    auto copy = a;
+    function(copy.data(), b.data(), copy.data(), copy.size(), 0.5f);
+    function(a.data(), b.data(), output.data(), a.size(), 0.5f);
+    BOOST_CHECK( copy == output );
+}
+
+BOOST_AUTO_TEST_CASE( test_rgb )
+{
+    BOOST_TEST_MESSAGE( "Blend instruction set: " << blend::instruction_set() );
+    check_blend<repr::RGBf>(blend::rgb);
+}
+
+BOOST_AUTO_TEST_CASE( test_linear )
+{
+    check_blend<repr::XYZ>(blend::linear);
+}
+
+BOOST_AUTO_TEST_CASE( test_lab )
+{
+    check_blend<repr::Lab>(blend::lab);
+}
+
+BOOST_AUTO_TEST_CASE( test_premultiply )
+{
+    auto colors = random_colors(3);
+    std::vector<PackedColor> output(colors.size());
+    blend::premultiply(colors.data(), output.data(), colors.size());
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        int alpha = colors[i].alpha();
+        auto premultiplied = [alpha](int channel) { return (channel * alpha + 127) / 255; };
+        BOOST_CHECK_EQUAL( output[i].alpha(), alpha );
+        BOOST_CHECK_EQUAL( output[i].red(), premultiplied(colors[i].red()) );
+        BOOST_CHECK_EQUAL( output[i].green(), premultiplied(colors[i].green()) );
+        BOOST_CHECK_EQUAL( output[i].blue(), premultiplied(colors[i].blue()) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_over )
+{
+    auto source = random_colors(4);
+    auto destination = random_colors(5);
+    blend::premultiply(source.data(), source.data(), source.size());
+    blend::premultiply(destination.data(), destination.data(), destination.size());
+
+    auto result = destination;
+    blend::over(source.data(), result.data(), result.size());
+    for ( std::size_t i = 0; i < source.size(); i++ )
+    {
+        int inverse = 255 - source[i].alpha();
+        auto over = [inverse](int src, int dst) { return src + (dst * inverse + 127) / 255; };
+        BOOST_CHECK_EQUAL( result[i].alpha(), over(source[i].alpha(), destination[i].alpha()) );
+        BOOST_CHECK_EQUAL( result[i].red(), over(source[i].red(), destination[i].red()) );
+        BOOST_CHECK_EQUAL( result[i].green(), over(source[i].green(), destination[i].green()) );
+        BOOST_CHECK_EQUAL( result[i].blue(), over(source[i].blue(), destination[i].blue()) );
+    }
+
+    PackedColor opaque(10, 20, 30);
+    PackedColor transparent(0, 0, 0, 0);
+    PackedColor target(1, 2, 3, 4);
+    blend::over(&opaque, &target, 1);
+    BOOST_CHECK( target == opaque );
+    blend::over(&transparent, &target, 1);
+    BOOST_CHECK( target == opaque );
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid_result )
+{
+    // Adds up to invalid_argb, enough colors for the vector and scalar code
+    std::vector<PackedColor> source(11, PackedColor(0x00, 0x00, 0x01, 0x00));
+    std::vector<PackedColor> destination(11, PackedColor(0xff, 0x00, 0xfe, 0x00));
+    blend::over(source.data(), destination.data(), destination.size());
+    for ( const auto& color : destination )
+    {
+        BOOST_CHECK( color.valid() );
+        BOOST_CHECK_EQUAL( color.argb(), PackedColor::valid_argb(invalid_argb) );
+    }
+}
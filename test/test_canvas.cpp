@@ -0,0 +1,191 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2016 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define BOOST_TEST_MODULE Test_Canvas
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+#include <QApplication>
+
+#include "view/canvas.hpp"
+
+using namespace view;
+
+/**
+ * \brief Runs the tests without a display
+ */
+struct Application
+{
+    Application()
+    {
+        if ( qgetenv("QT_QPA_PLATFORM").isEmpty() )
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        app.reset(new QApplication(argc, argv));
+    }
+
+    int argc = 1;
+    char name[12] = "test_canvas";
+    char* argv[2] = {name, nullptr};
+    std::unique_ptr<QApplication> app;
+};
+
+BOOST_GLOBAL_FIXTURE( Application );
+
+static constexpr QRgb background = 0xffffffff;
+static constexpr QRgb ink = 0xff000000;
+
+/**
+ * \brief 2x3 glyphs, '#' is solid
+ */
+static GlyphCache test_glyphs()
+{
+    std::vector<uint8_t> coverage(GlyphCache::glyph_count * 6, 0);
+    std::fill_n(coverage.begin() + GlyphCache::index('#') * 6, 6, 255);
+    return GlyphCache(QSize(2, 3), coverage);
+}
+
+/**
+ * \brief Canvas of 10x5 cells
+ */
+struct CanvasFixture
+{
+    CanvasFixture()
+    {
+        canvas.set_glyphs(test_glyphs());
+        canvas.set_background(background);
+        canvas.set_document(&document);
+        canvas.resize(20, 15);
+        canvas.show();
+        layer = document.add_layer(0x000000);
+    }
+
+    /**
+     * \brief Paints the canvas and returns the result
+     */
+    QImage paint()
+    {
+        return canvas.grab().toImage().convertToFormat(QImage::Format_RGB32);
+    }
+
+    /**
+     * \brief Whether the cell at \p pos in \p image is drawn with ink
+     */
+    bool has_ink(const QImage& image, QPoint pos)
+    {
+        return image.pixel(pos.x() * 2 + 1, pos.y() * 3 + 1) == ink;
+    }
+
+    doc::Document document;
+    doc::Layer* layer;
+    Canvas canvas;
+};
+
+BOOST_FIXTURE_TEST_CASE( test_cells, CanvasFixture )
+{
+    BOOST_CHECK_EQUAL( canvas.cells_at(canvas.rect()), QRect(0, 0, 10, 5) );
+    BOOST_CHECK_EQUAL( canvas.pixels_of(QRect(1, 1, 2, 1)), QRect(2, 3, 4, 3) );
+
+    canvas.set_origin(QPoint(-3, 4));
+    BOOST_CHECK_EQUAL( canvas.cells_at(QRect(0, 0, 1, 1)), QRect(-2, 1, 1, 1) );
+    BOOST_CHECK_EQUAL( canvas.cells_at(canvas.rect()), QRect(-2, 1, 11, 6) );
+    BOOST_CHECK_EQUAL( canvas.pixels_of(QRect(0, 0, 1, 1)), QRect(3, -4, 2, 3) );
+}
+
+BOOST_FIXTURE_TEST_CASE( test_visible_region, CanvasFixture )
+{
+    layer->set_char(QPoint(2, 1), '#');
+    layer->set_char(QPoint(15, 1), '#');
+    layer->set_char(QPoint(-3, -3), '#');
+
+    QImage image = paint();
+    BOOST_CHECK( canvas.dirty_region().isEmpty() );
+    BOOST_CHECK( has_ink(image, QPoint(2, 1)) );
+    BOOST_CHECK( !has_ink(image, QPoint(3, 1)) );
+    BOOST_CHECK_EQUAL( image.pixel(19, 14), background );
+
+    // Cells outside the widget are shifted in place when scrolling
+    canvas.set_origin(QPoint(12, 0));
+    image = paint();
+    BOOST_CHECK( has_ink(image, QPoint(9, 1)) );
+    BOOST_CHECK( !has_ink(image, QPoint(2, 1)) );
+
+    canvas.set_origin(QPoint(-6, -9));
+    image = paint();
+    BOOST_CHECK( has_ink(image, QPoint(0, 0)) );
+    BOOST_CHECK( has_ink(image, QPoint(5, 4)) );
+    BOOST_CHECK( !has_ink(image, QPoint(1, 0)) );
+}
+
+BOOST_FIXTURE_TEST_CASE( test_scroll_matches_render, CanvasFixture )
+{
+    for ( int y = -10; y < 20; y++ )
+        for ( int x = -10; x < 30; x++ )
+            if ( (x * 7 + y * 3) % 5 == 0 )
+                layer->set_char(QPoint(x, y), '#');
+
+    paint();
+    for ( QPoint origin : {QPoint(1, 0), QPoint(5, -2), QPoint(-7, 11), QPoint(40, 40), QPoint(0, 0)} )
+    {
+        canvas.set_origin(origin);
+        QImage scrolled = paint();
+
+        // Same contents drawn without reusing the buffer
+        Canvas fresh;
+        fresh.set_glyphs(test_glyphs());
+        fresh.set_background(background);
+        fresh.set_document(&document);
+        fresh.resize(canvas.size());
+        fresh.set_origin(origin);
+        fresh.show();
+        BOOST_CHECK( scrolled == fresh.grab().toImage().convertToFormat(QImage::Format_RGB32) );
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( test_dirty_region, CanvasFixture )
+{
+    paint();
+    BOOST_CHECK( canvas.dirty_region().isEmpty() );
+
+    // Only the changed cell is redrawn
+    layer->set_char(QPoint(3, 2), '#');
+    BOOST_CHECK_EQUAL( canvas.dirty_region(), QRegion(6, 6, 2, 3) );
+    BOOST_CHECK( has_ink(paint(), QPoint(3, 2)) );
+    BOOST_CHECK( canvas.dirty_region().isEmpty() );
+
+    // Changes outside the widget are ignored
+    layer->set_char(QPoint(30, 2), '#');
+    layer->set_char(QPoint(-1, 0), '#');
+    BOOST_CHECK( canvas.dirty_region().isEmpty() );
+
+    // Partially visible cells are clipped
+    canvas.set_origin(QPoint(1, 0));
+    paint();
+    layer->set_char(QPoint(0, 4), '#');
+    BOOST_CHECK_EQUAL( canvas.dirty_region(), QRegion(0, 12, 1, 3) );
+
+    // Color changes redraw the whole layer
+    paint();
+    layer->set_color(0xff0000);
+    BOOST_CHECK_EQUAL( canvas.dirty_region(), QRegion(canvas.pixels_of(QRect(-1, 0, 32, 5)) & canvas.rect()) );
+    QImage image = paint();
+    BOOST_CHECK_EQUAL( image.pixel(5, 7), 0xffff0000 );
+}
@@ -22,6 +22,9 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
+#include <cmath>
+#include <vector>
+
 #include "color/color.hpp"
 
 using boost::test_tools::output_test_stream;
@@ -172,9 +175,89 @@ BOOST_AUTO_TEST_CASE( test_to_hsvf )
     check(Color(255, 255, 255), repr::HSVf(0, 0, 1));
     check(Color(0, 0, 0), repr::HSVf(0, 0, 0));
 
+    // Red is the largest channel and blue isn't 0
+    check(Color(200, 150, 100), repr::HSVf(0.5/6.0, 0.5, 200/255.0));
+    check(Color(200, 100, 150), repr::HSVf(5.5/6.0, 0.5, 200/255.0));
+
     #undef check
 }
 
+/**
+ * \brief Colors spread across the RGB cube, including the edges
+ */
+static std::vector<Color> hsv_samples()
+{
+    std::vector<Color> colors;
+    for ( int r = 0; r < 256; r += 17 )
+        for ( int g = 0; g < 256; g += 5 )
+            for ( int b = 0; b < 256; b += 3 )
+                colors.emplace_back(r, g, b);
+    return colors;
+}
+
+BOOST_AUTO_TEST_CASE( test_to_hsv )
+{
+    static_assert(Color(255, 0, 0).to<repr::HSV>().s == 255, "Must be constexpr");
+
+    BOOST_CHECK_EQUAL(Color(255, 0, 0).to<repr::HSV>().h, 0);
+    BOOST_CHECK_EQUAL(Color(255, 255, 0).to<repr::HSV>().h, 10923);
+    BOOST_CHECK_EQUAL(Color(0, 255, 255).to<repr::HSV>().h, 32768);
+    BOOST_CHECK_EQUAL(Color(255, 0, 255).to<repr::HSV>().h, 54613);
+    BOOST_CHECK_EQUAL(Color(128, 128, 128).to<repr::HSV>().s, 0);
+    BOOST_CHECK_EQUAL(Color(128, 128, 128).to<repr::HSV>().v, 128);
+    BOOST_CHECK_EQUAL(Color(0, 0, 0).to<repr::HSV>().s, 0);
+
+    for ( const Color& color : hsv_samples() )
+    {
+        repr::HSV fixed = color.to<repr::HSV>();
+        repr::HSVf expected = color.to<repr::HSVf>();
+        // Hue is compared on the circle, 1/65536 of a turn apart at most
+        int16_t hue_error = fixed.h - melanolib::math::round<uint32_t>(expected.h * 65536);
+        BOOST_CHECK_LE( std::abs(hue_error), 1 );
+        BOOST_CHECK_LE( std::abs(fixed.s - expected.s * 255), 0.51 );
+        BOOST_CHECK_EQUAL( fixed.v, melanolib::math::round<int>(expected.v * 255) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_from_hsv )
+{
+    BOOST_CHECK_EQUAL(Color(repr::HSV(0, 255, 255)), Color(255, 0, 0));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(10923, 255, 255)), Color(255, 255, 0));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(21845, 255, 255)), Color(0, 255, 0));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(32768, 255, 255)), Color(0, 255, 255));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(43691, 255, 255)), Color(0, 0, 255));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(54613, 255, 255)), Color(255, 0, 255));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(65535, 255, 255)), Color(255, 0, 0));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(12345, 0, 77)), Color(77, 77, 77));
+    BOOST_CHECK_EQUAL(Color(repr::HSV(12345, 255, 0)), Color(0, 0, 0));
+
+    // Same as the floating point conversion, within rounding
+    for ( uint32_t h = 0; h < 0x10000; h += 97 )
+        for ( int s = 0; s < 256; s += 15 )
+            for ( int v = 0; v < 256; v += 15 )
+            {
+                Color fixed(repr::HSV(h, s, v));
+                Color expected(repr::HSVf(h / 65536.f, s / 255.f, v / 255.f));
+                BOOST_CHECK_LE( std::abs(fixed.red() - expected.red()), 1 );
+                BOOST_CHECK_LE( std::abs(fixed.green() - expected.green()), 1 );
+                BOOST_CHECK_LE( std::abs(fixed.blue() - expected.blue()), 1 );
+            }
+}
+
+BOOST_AUTO_TEST_CASE( test_hsv_round_trip )
+{
+    for ( int rgb = 0; rgb < (1 << 24); rgb++ )
+    {
+        Color color{repr::RGB_int24(rgb)};
+        Color converted(color.to<repr::HSV>());
+        if ( converted != color )
+        {
+            BOOST_CHECK_EQUAL( converted, color );
+            break;
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE( test_lab )
 {
     double tolerance = 1.1; // Tolerance percentage
@@ -209,6 +292,44 @@ BOOST_AUTO_TEST_CASE( test_distance )
     BOOST_CHECK_LT(a.distance(d), a.distance(e));
 }
 
+BOOST_AUTO_TEST_CASE( test_delta_e )
+{
+    // Pairs from Sharma, Wu and Dalal, "The CIEDE2000 color-difference formula"
+    struct Pair
+    {
+        repr::Lab a, b;
+        float cie76, cie94, ciede2000;
+    };
+    Pair pairs[] = {
+        {{50, 2.6772, -79.7751}, {50, 0, -82.7485}, 4.0011, 1.3950, 2.0425},
+        {{50, 0, 0}, {50, -1, 2}, 2.2361, 2.2361, 2.3669},
+        {{50, 2.5, 0}, {73, 25, -18}, 36.8680, 34.6892, 27.1492},
+        {{60.2574, -34.0099, 36.2677}, {60.4626, -34.1751, 39.4387}, 3.1819, 1.3910, 1.2644},
+        {{22.7233, 20.0904, -46.6940}, {23.0331, 14.9730, -42.5619}, 6.5847, 2.5561, 2.0373},
+        {{90.9257, -0.5406, -0.9208}, {88.6381, -0.8985, -0.7239}, 2.3238, 2.3226, 1.5381},
+    };
+    for ( const Pair& pair : pairs )
+    {
+        BOOST_CHECK_CLOSE(delta_e(pair.a, pair.b), pair.cie76, 0.01);
+        BOOST_CHECK_CLOSE(delta_e(pair.a, pair.b, DeltaE::CIE94), pair.cie94, 0.01);
+        BOOST_CHECK_CLOSE(delta_e(pair.a, pair.b, DeltaE::CIEDE2000), pair.ciede2000, 0.01);
+        BOOST_CHECK_CLOSE(delta_e2000(pair.b, pair.a), pair.ciede2000, 0.01);
+        BOOST_CHECK_CLOSE(delta_e_squared(pair.a, pair.b), pair.cie76 * pair.cie76, 0.02);
+    }
+
+    // CIE94 weights depend on the chroma of the reference
+    repr::Lab gray(50, 0, 0);
+    repr::Lab saturated(50, 60, 0);
+    BOOST_CHECK_GT(delta_e94(gray, saturated), delta_e94(saturated, gray));
+
+    Color red(255, 0, 0);
+    Color orange(255, 128, 0);
+    BOOST_CHECK_CLOSE(red.distance(orange, DeltaE::CIEDE2000),
+                      delta_e2000(red.to<repr::Lab>(), orange.to<repr::Lab>()), 0.001);
+    BOOST_CHECK_SMALL(red.distance(red, DeltaE::CIEDE2000), 0.01f);
+    BOOST_CHECK_SMALL(red.distance(red, DeltaE::CIE94), 0.01f);
+}
+
 BOOST_AUTO_TEST_CASE( test_blend )
 {
     Color a(10, 20, 30, 0);
@@ -301,3 +422,139 @@ BOOST_AUTO_TEST_CASE( test_rgb_int3_round_trip )
             BOOST_CHECK_EQUAL(converted.bright, rgb3.bright);
         }
 }
+
+BOOST_AUTO_TEST_CASE( test_kernel_srgb8_to_linear )
+{
+    for ( int i = 0; i < 256; i++ )
+    {
+        double v = i / 255.0;
+        double expected = (v > 0.04045 ? std::pow((v + 0.055) / 1.055, 2.4) : v / 12.92) * 100;
+        BOOST_CHECK_CLOSE( kernel::srgb8_to_linear(i), expected, 1e-4 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_kernel_cbrt )
+{
+    for ( float v = 1e-4; v < 2; v *= 1.01 )
+        BOOST_CHECK_CLOSE( kernel::cbrt(v), std::cbrt(v), 1e-4 );
+}
+
+BOOST_AUTO_TEST_CASE( test_kernel_linear_to_srgb )
+{
+    for ( int i = -10; i <= 1100; i++ )
+    {
+        float v = i / 1000.f;
+        double expected = v > 0.0031308 ? 1.055 * std::pow(v, 1 / 2.4) - 0.055 : 12.92 * v;
+        BOOST_CHECK_SMALL( kernel::linear_to_srgb(v) - expected, 1e-6 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_kernel_lab_f )
+{
+    for ( int i = -10; i <= 1100; i++ )
+    {
+        float v = i / 1000.f;
+        double expected = v > 0.008856 ? std::pow(v, 1.0 / 3) : 7.787 * v + 16.0 / 116;
+        BOOST_CHECK_SMALL( kernel::lab_f(v) - expected, 1e-6 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_kernel_arrays )
+{
+    // Odd size to exercise the scalar tail after the vector loop
+    std::vector<float> input;
+    for ( int i = -10; i <= 1100; i++ )
+        input.push_back(i / 1000.f);
+
+    auto srgb = input;
+    kernel::linear_to_srgb(srgb.data(), srgb.size());
+    auto lab = input;
+    kernel::lab_f(lab.data(), lab.size());
+
+    BOOST_TEST_MESSAGE( "Kernel instruction set: " << kernel::instruction_set() );
+    for ( std::size_t i = 0; i < input.size(); i++ )
+    {
+        BOOST_CHECK_EQUAL( srgb[i], kernel::linear_to_srgb(input[i]) );
+        BOOST_CHECK_EQUAL( lab[i], kernel::lab_f(input[i]) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_lab_round_trip )
+{
+    for ( int r = 0; r < 256; r += 5 )
+        for ( int g = 0; g < 256; g += 5 )
+            for ( int b = 0; b < 256; b += 5 )
+            {
+                Color color(r, g, b);
+                BOOST_CHECK_EQUAL( Color(color.to<repr::Lab>()), color );
+                BOOST_CHECK_EQUAL( Color(color.to<repr::XYZ>()), color );
+            }
+}
+
+/**
+ * \brief Values computed at compile time, compared with the run time ones
+ */
+struct ConstexprSamples
+{
+    static constexpr int count = 200;
+    float input[count];
+    float sqrt[count];
+    int32_t bits[count];
+    float cbrt[count];
+    float srgb[count];
+
+    constexpr ConstexprSamples()
+        : input{}, sqrt{}, bits{}, cbrt{}, srgb{}
+    {
+        float v = 1e-40f;
+        for ( int i = 0; i < count; i++ )
+        {
+            input[i] = v;
+            sqrt[i] = cx::sqrt(v);
+            bits[i] = cx::float_bits(v);
+            cbrt[i] = kernel::cbrt(v);
+            srgb[i] = kernel::linear_to_srgb(v);
+            v *= 1.7f;
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_constexpr_math )
+{
+    static constexpr ConstexprSamples samples;
+    for ( int i = 0; i < ConstexprSamples::count; i++ )
+    {
+        float v = samples.input[i];
+        BOOST_CHECK_EQUAL( samples.sqrt[i], std::sqrt(v) );
+        BOOST_CHECK_EQUAL( samples.bits[i], cx::float_bits(v) );
+        BOOST_CHECK_EQUAL( cx::bits_float(samples.bits[i]), v );
+        BOOST_CHECK_EQUAL( samples.cbrt[i], kernel::cbrt(v) );
+        BOOST_CHECK_EQUAL( samples.srgb[i], kernel::linear_to_srgb(v) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_constexpr_conversions )
+{
+    constexpr Color color(12, 200, 34);
+    constexpr repr::Lab lab = color.to<repr::Lab>();
+    constexpr repr::XYZ xyz = color.to<repr::XYZ>();
+    static_assert(Color(lab) == color, "Lab round trip");
+    static_assert(Color(xyz) == color, "XYZ round trip");
+
+    Color runtime_color(color.red(), color.green(), color.blue());
+    BOOST_CHECK_EQUAL( lab.l, runtime_color.to<repr::Lab>().l );
+    BOOST_CHECK_EQUAL( lab.a, runtime_color.to<repr::Lab>().a );
+    BOOST_CHECK_EQUAL( lab.b, runtime_color.to<repr::Lab>().b );
+    BOOST_CHECK_EQUAL( xyz.x, runtime_color.to<repr::XYZ>().x );
+    BOOST_CHECK_EQUAL( xyz.y, runtime_color.to<repr::XYZ>().y );
+    BOOST_CHECK_EQUAL( xyz.z, runtime_color.to<repr::XYZ>().z );
+
+    constexpr Color blended = Color(255, 0, 0).blend<repr::Lab>(Color(0, 0, 255));
+    BOOST_CHECK_EQUAL( blended, Color(255, 0, 0).blend<repr::Lab>(Color(0, 0, 255)) );
+}
+
+BOOST_AUTO_TEST_CASE( test_out_of_gamut )
+{
+    BOOST_CHECK_EQUAL( Color(repr::XYZ(200, 200, 200)), Color(255, 255, 255) );
+    BOOST_CHECK_EQUAL( Color(repr::XYZ(-10, -10, -10)), Color(0, 0, 0) );
+}
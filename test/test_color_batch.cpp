@@ -0,0 +1,174 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Color_Batch
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "color/batch.hpp"
+
+using namespace color;
+
+/**
+ * \brief Colors sampled across the RGB cube, more than a conversion block
+ */
+std::vector<Color> sample_colors()
+{
+    std::vector<Color> colors;
+    for ( int r = 0; r < 256; r += 15 )
+        for ( int g = 0; g < 256; g += 15 )
+            for ( int b = 0; b < 256; b += 15 )
+                colors.emplace_back(r, g, b);
+    for ( int i = 0; i < 256; i++ )
+        colors.emplace_back(i, i, i);
+    return colors;
+}
+
+BOOST_AUTO_TEST_CASE( test_to_xyz )
+{
+    auto colors = sample_colors();
+    std::vector<repr::XYZ> output(colors.size(), repr::XYZ(0, 0, 0));
+    convert(colors.data(), colors.data() + colors.size(), output.data());
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        auto expected = colors[i].to<repr::XYZ>();
+        BOOST_CHECK_EQUAL( output[i].x, expected.x );
+        BOOST_CHECK_EQUAL( output[i].y, expected.y );
+        BOOST_CHECK_EQUAL( output[i].z, expected.z );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_to_lab )
+{
+    auto colors = sample_colors();
+    std::vector<repr::Lab> output(colors.size(), repr::Lab(0, 0, 0));
+    convert(colors.data(), colors.data() + colors.size(), output.data());
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        auto expected = colors[i].to<repr::Lab>();
+        BOOST_CHECK_EQUAL( output[i].l, expected.l );
+        BOOST_CHECK_EQUAL( output[i].a, expected.a );
+        BOOST_CHECK_EQUAL( output[i].b, expected.b );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_from_xyz_lab )
+{
+    auto colors = sample_colors();
+    std::vector<repr::XYZ> xyz(colors.size(), repr::XYZ(0, 0, 0));
+    std::vector<repr::Lab> lab(colors.size(), repr::Lab(0, 0, 0));
+    convert(colors.data(), colors.data() + colors.size(), xyz.data());
+    convert(colors.data(), colors.data() + colors.size(), lab.data());
+
+    std::vector<Color> from_xyz(colors.size());
+    std::vector<Color> from_lab(colors.size());
+    convert(xyz.data(), xyz.data() + xyz.size(), from_xyz.data());
+    convert(lab.data(), lab.data() + lab.size(), from_lab.data(), 12);
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        BOOST_CHECK_EQUAL( from_xyz[i], Color(xyz[i]) );
+        BOOST_CHECK_EQUAL( from_lab[i], Color(lab[i], 12) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_scalar_reprs )
+{
+    auto colors = sample_colors();
+    std::vector<repr::HSVf> hsv(colors.size(), repr::HSVf(0, 0, 0));
+    std::vector<repr::RGB_int24> rgb24(colors.size(), repr::RGB_int24(0));
+    convert(colors.data(), colors.data() + colors.size(), hsv.data());
+    convert(colors.data(), colors.data() + colors.size(), rgb24.data());
+
+    std::vector<Color> from_hsv(colors.size());
+    std::vector<Color> from_rgb24(colors.size());
+    convert(hsv.data(), hsv.data() + hsv.size(), from_hsv.data());
+    convert(rgb24.data(), rgb24.data() + rgb24.size(), from_rgb24.data());
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        BOOST_CHECK_EQUAL( hsv[i].h, colors[i].to<repr::HSVf>().h );
+        BOOST_CHECK_EQUAL( rgb24[i].rgb, colors[i].to<repr::RGB_int24>().rgb );
+        BOOST_CHECK_EQUAL( from_hsv[i], Color(hsv[i]) );
+        BOOST_CHECK_EQUAL( from_rgb24[i], colors[i] );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_repr_to_repr )
+{
+    auto colors = sample_colors();
+    std::vector<repr::RGB_int24> rgb24(colors.size(), repr::RGB_int24(0));
+    std::vector<repr::Lab> lab(colors.size(), repr::Lab(0, 0, 0));
+    std::vector<repr::RGB_int3> rgb3(colors.size(), repr::RGB_int3(0));
+    convert(colors.data(), colors.data() + colors.size(), rgb24.data());
+    convert(rgb24.data(), rgb24.data() + rgb24.size(), lab.data());
+    convert(rgb24.data(), rgb24.data() + rgb24.size(), rgb3.data());
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        BOOST_CHECK_EQUAL( lab[i].l, colors[i].to<repr::Lab>().l );
+        BOOST_CHECK_EQUAL( rgb3[i].rgb, colors[i].to<repr::RGB_int3>().rgb );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_hsv )
+{
+    auto colors = sample_colors();
+    std::vector<repr::HSV> hsv(colors.size());
+    convert(colors.data(), colors.data() + colors.size(), hsv.data());
+
+    std::vector<Color> from_hsv(colors.size());
+    convert(hsv.data(), hsv.data() + hsv.size(), from_hsv.data());
+
+    for ( std::size_t i = 0; i < colors.size(); i++ )
+    {
+        BOOST_CHECK_EQUAL( hsv[i].h, colors[i].to<repr::HSV>().h );
+        BOOST_CHECK_EQUAL( from_hsv[i], colors[i] );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_rotate_hue )
+{
+    std::vector<Color> colors = {
+        Color(255, 0, 0), Color(0, 255, 0, 128), Color(0, 0, 255), Color(90, 90, 90)
+    };
+    std::vector<Color> output(colors.size());
+
+    rotate_hue(colors.data(), colors.data() + colors.size(), output.data(), 0);
+    BOOST_CHECK( output == colors );
+
+    rotate_hue(colors.data(), colors.data() + colors.size(), output.data(), 21845);
+    BOOST_CHECK_EQUAL( output[0], Color(0, 255, 0) );
+    BOOST_CHECK_EQUAL( output[1], Color(0, 0, 255, 128) );
+    BOOST_CHECK_EQUAL( output[2], Color(255, 0, 0) );
+    BOOST_CHECK_EQUAL( output[3], Color(90, 90, 90) );
+
+    // Rotating backwards wraps around
+    rotate_hue(colors.data(), colors.data() + colors.size(), output.data(), -21845);
+    BOOST_CHECK_EQUAL( output[0], Color(0, 0, 255) );
+
+    auto sample = sample_colors();
+    std::vector<Color> rotated(sample.size());
+    rotate_hue(sample.data(), sample.data() + sample.size(), rotated.data(), 0);
+    BOOST_CHECK( rotated == sample );
+}
@@ -50,3 +50,88 @@ BOOST_AUTO_TEST_CASE( test_to_qt )
 
     BOOST_CHECK_EQUAL( to_qrgb(Color(1, 2, 3, 4)), qRgba(1, 2, 3, 4) );
 }
+
+BOOST_AUTO_TEST_CASE( test_from_qimage )
+{
+    QImage argb(3, 2, QImage::Format_ARGB32);
+    argb.setPixel(0, 0, qRgba(1, 2, 3, 4));
+    argb.setPixel(1, 0, qRgba(255, 128, 0, 255));
+    argb.setPixel(2, 0, qRgba(0, 0, 0, 0));
+    argb.setPixel(0, 1, qRgba(10, 20, 30, 40));
+    argb.setPixel(1, 1, qRgba(50, 60, 70, 80));
+    argb.setPixel(2, 1, qRgba(90, 100, 110, 120));
+
+    for ( auto format : {QImage::Format_ARGB32, QImage::Format_RGB32,
+                         QImage::Format_RGB888, QImage::Format_ARGB32_Premultiplied} )
+    {
+        QImage image = argb.convertToFormat(format);
+        std::vector<Color> colors = from_qimage(image);
+        BOOST_REQUIRE_EQUAL( colors.size(), 6u );
+        for ( int y = 0; y < image.height(); y++ )
+            for ( int x = 0; x < image.width(); x++ )
+                BOOST_CHECK_EQUAL( colors[y * 3 + x], from_qt(image.pixelColor(x, y)) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_to_qimage )
+{
+    std::vector<Color> colors{
+        Color(1, 2, 3, 4), Color(255, 128, 0), Color(10, 20, 30, 40),
+        Color(50, 60, 70), Color(90, 100, 110, 120), Color(0, 0, 0, 0),
+    };
+
+    QImage image = to_qimage(colors.data(), QSize(2, 3));
+    BOOST_CHECK( image.format() == QImage::Format_ARGB32 );
+    BOOST_CHECK_EQUAL( image.width(), 2 );
+    BOOST_CHECK_EQUAL( image.height(), 3 );
+    for ( int y = 0; y < 3; y++ )
+        for ( int x = 0; x < 2; x++ )
+            BOOST_CHECK_EQUAL( image.pixel(x, y), to_qrgb(colors[y * 2 + x]) );
+    BOOST_CHECK( from_qimage(image) == colors );
+
+    for ( auto format : {QImage::Format_RGB32, QImage::Format_RGB888} )
+    {
+        QImage opaque(2, 3, format);
+        for ( int y = 0; y < 3; y++ )
+            to_qimage_row(colors.data() + y * 2, opaque, y);
+        for ( int y = 0; y < 3; y++ )
+            for ( int x = 0; x < 2; x++ )
+                BOOST_CHECK_EQUAL( opaque.pixel(x, y), to_qrgb(colors[y * 2 + x]) | 0xff000000 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_qimage_packed )
+{
+    QImage image(3, 2, QImage::Format_ARGB32);
+    image.setPixel(0, 0, qRgba(1, 2, 3, 4));
+    image.setPixel(1, 0, qRgba(255, 128, 0, 255));
+    image.setPixel(2, 0, invalid_argb);
+    image.setPixel(0, 1, qRgba(10, 20, 30, 40));
+    image.setPixel(1, 1, qRgba(50, 60, 70, 80));
+    image.setPixel(2, 1, qRgba(90, 100, 110, 120));
+
+    for ( auto format : {QImage::Format_ARGB32, QImage::Format_RGB32, QImage::Format_RGB888} )
+    {
+        QImage converted = image.convertToFormat(format);
+        std::vector<PackedColor> packed = from_qimage_packed(converted);
+        std::vector<Color> colors = from_qimage(converted);
+        BOOST_REQUIRE_EQUAL( packed.size(), 6u );
+        for ( std::size_t i = 0; i < packed.size(); i++ )
+        {
+            BOOST_CHECK( packed[i].valid() );
+            BOOST_CHECK_EQUAL( packed[i].argb(), PackedColor::valid_argb(to_qrgb(colors[i])) );
+        }
+
+        QImage written(3, 2, format);
+        for ( int y = 0; y < 2; y++ )
+            to_qimage_row(packed.data() + y * 3, written, y);
+        for ( int y = 0; y < 2; y++ )
+            for ( int x = 0; x < 3; x++ )
+                BOOST_CHECK_EQUAL( written.pixel(x, y), PackedColor::valid_argb(converted.pixel(x, y)) );
+    }
+
+    std::vector<PackedColor> packed{PackedColor(1, 2, 3, 4), PackedColor()};
+    QImage written = to_qimage(packed.data(), QSize(2, 1));
+    BOOST_CHECK_EQUAL( written.pixel(0, 0), qRgba(1, 2, 3, 4) );
+    BOOST_CHECK_EQUAL( written.pixel(1, 0), invalid_argb );
+}
@@ -21,7 +21,13 @@
 
 #include <boost/test/unit_test.hpp>
 
-#include "document/layer.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "document/document.hpp"
 
 using namespace doc;
 
@@ -42,15 +48,52 @@ BOOST_AUTO_TEST_CASE( test_layer_char )
     BOOST_CHECK_EQUAL(layer.to_string(), "P");
     layer.set_char({1, 1}, '!');
     layer.set_char({2, 0}, 'o');
-    BOOST_CHECK_EQUAL(layer.to_string(), "P o\n!");
+    BOOST_CHECK_EQUAL(layer.to_string(), "P o\n !");
     BOOST_CHECK_EQUAL(layer.char_at({2, 0}), 'o');
     BOOST_CHECK_EQUAL(layer.char_at({20, 20}), ' ');
     layer.remove_char({2, 0});
-    BOOST_CHECK_EQUAL(layer.to_string(), "P\n!");
+    BOOST_CHECK_EQUAL(layer.to_string(), "P\n !");
     layer.set_char({1, 1}, ' ');
     BOOST_CHECK_EQUAL(layer.to_string(), "P");
 }
 
+BOOST_AUTO_TEST_CASE( test_layer_to_string )
+{
+    Layer layer(0);
+    layer.set_char({3, 2}, 'a');
+    layer.set_char({5, 2}, 'b');
+    layer.set_char({1, 4}, 'c');
+    layer.set_char({70, 4}, 'd');
+    layer.set_char({0, 130}, 'e');
+
+    std::string expected = "\n\n   a b\n\n c" + std::string(68, ' ') + "d" +
+        std::string(126, '\n') + "e";
+    BOOST_CHECK_EQUAL(layer.to_string(), expected);
+
+    TextWriter writer(layer.characters());
+    BOOST_CHECK_EQUAL(writer.size(), expected.size());
+
+    std::vector<char> buffer(writer.size());
+    BOOST_CHECK(writer.write(buffer.data()) == buffer.data() + buffer.size());
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), expected);
+
+    std::ostringstream stream;
+    layer.write(stream);
+    BOOST_CHECK_EQUAL(stream.str(), expected);
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_to_string_negative )
+{
+    Layer layer(0);
+    layer.set_char({-2, -1}, 'a');
+    layer.set_char({1, 0}, 'b');
+    BOOST_CHECK_EQUAL(layer.to_string(), "a\n   b");
+
+    std::ostringstream stream;
+    layer.write(stream);
+    BOOST_CHECK_EQUAL(stream.str(), "a\n   b");
+}
+
 BOOST_AUTO_TEST_CASE( test_layer_color )
 {
     Layer layer(0);
@@ -72,3 +115,613 @@ BOOST_AUTO_TEST_CASE( test_layer_color )
     layer.set_color(1);
     BOOST_CHECK(!changed);
 }
+
+BOOST_AUTO_TEST_CASE( test_tile_map_index )
+{
+    typedef TileMap<char, 2> Map;
+    BOOST_CHECK_EQUAL(Map::tile_index(0), 0);
+    BOOST_CHECK_EQUAL(Map::tile_index(3), 0);
+    BOOST_CHECK_EQUAL(Map::tile_index(4), 1);
+    BOOST_CHECK_EQUAL(Map::tile_index(-1), -1);
+    BOOST_CHECK_EQUAL(Map::tile_index(-4), -1);
+    BOOST_CHECK_EQUAL(Map::tile_index(-5), -2);
+    BOOST_CHECK_EQUAL(Map::local(5), 1);
+    BOOST_CHECK_EQUAL(Map::local(-1), 3);
+    BOOST_CHECK_EQUAL(Map::local(-4), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_set )
+{
+    TileMap<char, 2> map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(map.get({1, 2}), '\0');
+
+    map.set({1, 2}, 'a');
+    map.set({-7, 2}, 'b');
+    map.set({2, 1}, 'c');
+    BOOST_CHECK_EQUAL(map.size(), 3u);
+    BOOST_CHECK_EQUAL(map.tile_count(), 2u);
+    BOOST_CHECK_EQUAL(map.get({1, 2}), 'a');
+    BOOST_CHECK_EQUAL(map.get({-7, 2}), 'b');
+    BOOST_CHECK_EQUAL(map.get({2, 1}), 'c');
+
+    map.set({1, 2}, 'd');
+    BOOST_CHECK_EQUAL(map.size(), 3u);
+    BOOST_CHECK_EQUAL(map.get({1, 2}), 'd');
+
+    BOOST_CHECK(map.erase({-7, 2}));
+    BOOST_CHECK(!map.erase({-7, 2}));
+    BOOST_CHECK_EQUAL(map.size(), 2u);
+    BOOST_CHECK_EQUAL(map.tile_count(), 1u);
+
+    map.set({2, 1}, '\0');
+    BOOST_CHECK_EQUAL(map.size(), 1u);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_iteration )
+{
+    TileMap<char, 2> map;
+    std::vector<QPoint> points{
+        {5, -3}, {-9, 0}, {0, 0}, {3, 0}, {4, 0}, {11, 0}, {-1, 1}, {7, 1}, {2, 9}
+    };
+    for ( auto it = points.rbegin(); it != points.rend(); ++it )
+        map.set(*it, 'x');
+
+    std::vector<QPoint> iterated;
+    for ( const auto& pair : map )
+        iterated.push_back(pair.first);
+
+    BOOST_CHECK_EQUAL(iterated.size(), points.size());
+    auto cmp = Layer::QPointCmp();
+    BOOST_CHECK(std::is_sorted(iterated.begin(), iterated.end(), cmp));
+    BOOST_CHECK(std::equal(iterated.begin(), iterated.end(), points.begin()));
+
+    TileMap<char, 2> copy = map;
+    map.clear();
+    BOOST_CHECK_EQUAL(std::size_t(std::distance(copy.begin(), copy.end())), points.size());
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_set_row )
+{
+    TileMap<char, 2> map;
+    std::string row("ab\0d\0\0gh", 8);
+    map.set_row(QPoint(-2, 1), row.data(), row.size());
+    BOOST_CHECK_EQUAL( map.size(), 5u );
+    BOOST_CHECK_EQUAL( map.tile_count(), 3u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(-2, 1)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(-1, 1)), 'b' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(0, 1)), '\0' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(5, 1)), 'h' );
+
+    // Clearing cells releases the tiles left empty
+    std::string clear(4, '\0');
+    map.set_row(QPoint(2, 1), clear.data(), clear.size());
+    BOOST_CHECK_EQUAL( map.size(), 3u );
+    BOOST_CHECK_EQUAL( map.tile_count(), 2u );
+    std::string expected;
+    for ( const auto& pair : map )
+        expected += pair.second;
+    BOOST_CHECK_EQUAL( expected, "abd" );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_set_row )
+{
+    Layer layer(0);
+    layer.set_char(QPoint(1, 0), 'x');
+    std::string row(100, '.');
+    row[1] = ' ';
+    row[2] = '\t';
+    layer.set_row(QPoint(0, 0), row.data(), row.size());
+    BOOST_CHECK_EQUAL( layer.characters().size(), 98u );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(1, 0)), ' ' );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(99, 0)), '.' );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(100, 0)), ' ' );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_region_changed )
+{
+    Layer layer(0);
+    std::vector<QRect> regions;
+    QObject::connect(&layer, &Layer::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+
+    layer.set_char(QPoint(1, 2), 'x');
+    layer.remove_char(QPoint(5, 5));
+    layer.set_char(QPoint(1, 2), ' ');
+    layer.set_row(QPoint(3, 4), "abc", 3);
+    BOOST_REQUIRE_EQUAL( regions.size(), 3u );
+    BOOST_CHECK( regions[0] == QRect(1, 2, 1, 1) );
+    BOOST_CHECK( regions[1] == QRect(1, 2, 1, 1) );
+    BOOST_CHECK( regions[2] == QRect(3, 4, 3, 1) );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_no_op_edits )
+{
+    Layer layer(0);
+    layer.set_char(QPoint(1, 2), 'x');
+    std::vector<QRect> announced;
+    QObject::connect(&layer, &Layer::about_to_change, [&announced](const QRect& region) {
+        announced.push_back(region);
+    });
+
+    // None of these changes a cell
+    layer.set_char(QPoint(1, 2), 'x');
+    layer.remove_char(QPoint(5, 5));
+    layer.set_char(QPoint(5, 5), ' ');
+    layer.clear_rect(QRect());
+    layer.clear_rect(QRect(3, 3, 0, 10));
+    BOOST_CHECK( announced.empty() );
+
+    layer.set_char(QPoint(1, 2), 'y');
+    layer.remove_char(QPoint(1, 2));
+    BOOST_REQUIRE_EQUAL( announced.size(), 2u );
+    BOOST_CHECK( announced[0] == QRect(1, 2, 1, 1) );
+    BOOST_CHECK( announced[1] == QRect(1, 2, 1, 1) );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_composite )
+{
+    Document document;
+    Layer* bottom = document.add_layer(1);
+    Layer* top = document.add_layer(2);
+    BOOST_CHECK_EQUAL( document.layer_count(), 2 );
+    BOOST_CHECK_EQUAL( document.layer_index(top), 1 );
+
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).character, ' ' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).layer, -1 );
+
+    bottom->set_row(QPoint(0, 0), "abc", 3);
+    top->set_char(QPoint(1, 0), 'X');
+    bottom->set_char(QPoint(1, 0), 'B');
+
+    Document::Cell cell = document.cell_at(QPoint(1, 0));
+    BOOST_CHECK_EQUAL( cell.character, 'X' );
+    BOOST_CHECK_EQUAL( cell.layer, 1 );
+    BOOST_CHECK_EQUAL( cell.color, 2u );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(2, 0)).character, 'c' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(2, 0)).color, 1u );
+
+    // Removing the top character uncovers the one below
+    top->remove_char(QPoint(1, 0));
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).character, 'B' );
+    bottom->remove_char(QPoint(1, 0));
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).layer, -1 );
+    BOOST_CHECK_EQUAL( document.composite().size(), 2u );
+
+    bottom->set_color(5);
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).color, 5u );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_layers )
+{
+    Document document;
+    Layer* a = document.add_layer(1);
+    a->set_char(QPoint(0, 0), 'a');
+    Layer* c = document.add_layer(3);
+    c->set_char(QPoint(1, 0), 'c');
+
+    Layer* b = document.insert_layer(1, 2);
+    b->set_row(QPoint(0, 0), "bb", 2);
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).character, 'b' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).character, 'c' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).layer, 2 );
+
+    std::vector<QRect> regions;
+    QObject::connect(&document, &Document::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+    document.remove_layer(1);
+    BOOST_CHECK_EQUAL( document.layer_count(), 2 );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).character, 'a' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).layer, 1 );
+    BOOST_REQUIRE_EQUAL( regions.size(), 1u );
+    BOOST_CHECK( regions[0] == QRect(0, 0, 2, 1) );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_layer_color )
+{
+    Document document;
+    Layer* a = document.add_layer(1);
+    Layer* b = document.add_layer(2);
+    a->set_row(QPoint(2, 3), "aaa", 3);
+    b->set_char(QPoint(1, 1), 'b');
+
+    std::vector<QRect> regions;
+    QObject::connect(&document, &Document::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+    a->set_color(5);
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(3, 3)).color, 5u );
+    BOOST_REQUIRE_EQUAL( regions.size(), 1u );
+    BOOST_CHECK( regions[0] == QRect(2, 3, 3, 1) );
+
+    // Empty layers have nothing to repaint
+    document.add_layer(3)->set_color(4);
+    BOOST_CHECK_EQUAL( regions.size(), 1u );
+
+    // Indices follow insertions and removals
+    Layer* bottom = document.insert_layer(0, 6);
+    BOOST_CHECK_EQUAL( document.layer_index(bottom), 0 );
+    BOOST_CHECK_EQUAL( document.layer_index(a), 1 );
+    BOOST_CHECK_EQUAL( document.layer_index(b), 2 );
+    document.remove_layer(1);
+    BOOST_CHECK_EQUAL( document.layer_index(b), 1 );
+    BOOST_CHECK_EQUAL( document.layer_index(bottom), 0 );
+    b->set_char(QPoint(1, 1), 'c');
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 1)).layer, 1 );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_many_layers )
+{
+    Document document;
+    for ( int i = 0; i < 60; i++ )
+        document.add_layer(i)->set_char(QPoint(i % 7, i % 5), 'A' + i % 26);
+
+    // Compare the composite with a scan of the layers
+    for ( int y = 0; y < 5; y++ )
+    {
+        for ( int x = 0; x < 7; x++ )
+        {
+            int expected = -1;
+            for ( int i = 0; i < document.layer_count(); i++ )
+                if ( document.layer(i)->char_at(QPoint(x, y)) != ' ' )
+                    expected = i;
+            BOOST_CHECK_EQUAL( document.cell_at(QPoint(x, y)).layer, expected );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_document_insert_remove )
+{
+    Document document;
+    std::mt19937 random(0);
+    for ( int step = 0; step < 200; step++ )
+    {
+        if ( document.layer_count() > 0 && random() % 3 == 0 )
+        {
+            document.remove_layer(random() % document.layer_count());
+        }
+        else
+        {
+            Layer* layer = document.insert_layer(random() % (document.layer_count() + 1), step);
+            for ( int i = 0; i < 4; i++ )
+                layer->set_char(QPoint(random() % 6, random() % 4), 'A' + step % 26);
+        }
+
+        // Compare the composite with a scan of the layers
+        for ( int y = 0; y < 4; y++ )
+        {
+            for ( int x = 0; x < 6; x++ )
+            {
+                int expected = -1;
+                for ( int i = 0; i < document.layer_count(); i++ )
+                    if ( document.layer(i)->char_at(QPoint(x, y)) != ' ' )
+                        expected = i;
+                BOOST_REQUIRE_EQUAL( document.cell_at(QPoint(x, y)).layer, expected );
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_for_each_in )
+{
+    TileMap<char, 2> map;
+    for ( int y = -10; y < 10; y++ )
+        for ( int x = -10; x < 10; x++ )
+            if ( (x + y) % 3 == 0 )
+                map.set(QPoint(x, y), 'a');
+
+    for ( QRect rect : {QRect(-3, -5, 7, 4), QRect(-10, -10, 20, 20), QRect(5, 5, 1, 1), QRect(20, 0, 5, 5)} )
+    {
+        std::vector<QPoint> expected;
+        for ( const auto& pair : map )
+            if ( rect.contains(pair.first) )
+                expected.push_back(pair.first);
+
+        std::vector<QPoint> visited;
+        map.for_each_in(rect, [&visited](QPoint pos, char) { visited.push_back(pos); });
+        std::sort(visited.begin(), visited.end(), Layer::QPointCmp());
+        BOOST_CHECK( visited == expected );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_edit_batch )
+{
+    Layer layer(0);
+    std::vector<QRect> regions;
+    QObject::connect(&layer, &Layer::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+
+    {
+        Layer::EditBatch batch(layer);
+        layer.set_char(QPoint(1, 2), 'x');
+        {
+            Layer::EditBatch nested(layer);
+            layer.set_row(QPoint(5, 0), "ab", 2);
+        }
+        layer.remove_char(QPoint(100, 100));
+        BOOST_CHECK( regions.empty() );
+    }
+    BOOST_REQUIRE_EQUAL( regions.size(), 1u );
+    BOOST_CHECK( regions[0] == QRect(1, 0, 6, 3) );
+
+    // Batches without changes are silent
+    layer.begin_edit();
+    layer.end_edit();
+    BOOST_CHECK_EQUAL( regions.size(), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_edit_batch )
+{
+    Document document;
+    Layer* bottom = document.add_layer(1);
+    Layer* top = document.add_layer(2);
+    bottom->set_row(QPoint(0, 0), "aaaa", 4);
+    top->set_char(QPoint(1000, 1000), 'X');
+
+    std::vector<QRect> regions;
+    QObject::connect(&document, &Document::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+
+    {
+        Layer::EditBatch batch(*top);
+        top->set_char(QPoint(1, 0), 'b');
+        top->remove_char(QPoint(1000, 1000));
+        top->set_char(QPoint(500, 2000), 'c');
+    }
+    BOOST_REQUIRE_EQUAL( regions.size(), 1u );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1, 0)).character, 'b' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(0, 0)).character, 'a' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(1000, 1000)).layer, -1 );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(500, 2000)).character, 'c' );
+    BOOST_CHECK_EQUAL( document.composite().size(), 5u );
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_fill_erase )
+{
+    TileMap<char, 2> map;
+    map.set(QPoint(0, 0), 'x');
+    map.fill(QRect(-3, -2, 7, 5), 'a');
+    BOOST_CHECK_EQUAL( map.size(), 35u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(0, 0)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(-3, -2)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(3, 2)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(4, 2)), '\0' );
+
+    BOOST_CHECK_EQUAL( map.erase(QRect(-1, -1, 2, 2)), 4u );
+    BOOST_CHECK_EQUAL( map.size(), 31u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(0, 0)), '\0' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(-2, -1)), 'a' );
+
+    std::size_t tiles = map.tile_count();
+    map.fill(QRect(-100, -100, 50, 50), '\0');
+    BOOST_CHECK_EQUAL( map.tile_count(), tiles );
+
+    BOOST_CHECK_EQUAL( map.erase(QRect(-10, -10, 20, 20)), 31u );
+    BOOST_CHECK( map.empty() );
+    BOOST_CHECK_EQUAL( map.tile_count(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_blit )
+{
+    TileMap<char, 2> source;
+    source.set(QPoint(0, 0), 'a');
+    source.set(QPoint(3, 0), 'b');
+    source.set(QPoint(-1, 5), 'c');
+
+    TileMap<char, 2> map;
+    map.set(QPoint(2, 1), 'x');
+    map.set(QPoint(3, 1), 'y');
+    QRect bounds = map.blit(source, QPoint(2, 1));
+    BOOST_CHECK( bounds == QRect(1, 1, 5, 6) );
+    BOOST_CHECK_EQUAL( map.size(), 4u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(2, 1)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(3, 1)), 'y' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(5, 1)), 'b' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(1, 6)), 'c' );
+
+    map.blit(map, QPoint(0, 1));
+    BOOST_CHECK_EQUAL( map.size(), 8u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(2, 2)), 'a' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(3, 2)), 'y' );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_bulk_edit )
+{
+    Layer layer(0);
+    std::vector<QRect> regions;
+    QObject::connect(&layer, &Layer::region_changed, [&regions](const QRect& region) {
+        regions.push_back(region);
+    });
+
+    layer.fill_rect(QRect(0, 0, 4, 2), '#');
+    BOOST_CHECK_EQUAL( layer.to_string(), "####\n####" );
+    layer.set_row(1, 1, "ab");
+    BOOST_CHECK_EQUAL( layer.to_string(), "####\n#ab#" );
+    layer.clear_rect(QRect(1, 0, 2, 1));
+    BOOST_CHECK_EQUAL( layer.to_string(), "#  #\n#ab#" );
+    layer.fill_rect(QRect(0, 1, 1, 1), ' ');
+    BOOST_CHECK_EQUAL( layer.to_string(), "#  #\n ab#" );
+
+    Layer stamp(0);
+    stamp.set_row(0, 0, "x y");
+    layer.blit(stamp, QPoint(0, 0));
+    BOOST_CHECK_EQUAL( layer.to_string(), "x y#\n ab#" );
+
+    BOOST_REQUIRE_EQUAL( regions.size(), 5u );
+    BOOST_CHECK( regions[4] == QRect(0, 0, 3, 1) );
+
+    // No-op edits are silent
+    layer.clear_rect(QRect(100, 100, 10, 10));
+    layer.blit(Layer(0), QPoint(0, 0));
+    BOOST_CHECK_EQUAL( regions.size(), 5u );
+
+    {
+        Layer::EditBatch batch(layer);
+        layer.fill_rect(QRect(0, 0, 2, 2), '.');
+        layer.fill_rect(QRect(10, 10, 2, 2), '.');
+    }
+    BOOST_REQUIRE_EQUAL( regions.size(), 6u );
+    BOOST_CHECK( regions[5] == QRect(0, 0, 12, 12) );
+}
+
+BOOST_AUTO_TEST_CASE( test_document_bulk_edit )
+{
+    Document document;
+    Layer* bottom = document.add_layer(1);
+    Layer* top = document.add_layer(2);
+    bottom->fill_rect(QRect(0, 0, 100, 100), 'a');
+    top->fill_rect(QRect(50, 50, 100, 100), 'b');
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(10, 10)).character, 'a' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(60, 60)).character, 'b' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(120, 120)).character, 'b' );
+
+    top->clear_rect(QRect(0, 0, 80, 80));
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(60, 60)).layer, 0 );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(60, 60)).character, 'a' );
+    BOOST_CHECK_EQUAL( document.cell_at(QPoint(90, 90)).character, 'b' );
+    BOOST_CHECK_EQUAL( document.composite().size(), 17500u );
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_copy_on_write )
+{
+    TileMap<char, 2> map;
+    map.fill(QRect(0, 0, 8, 8), 'a');
+    TileMap<char, 2> copy = map;
+
+    map.set(QPoint(1, 1), 'b');
+    map.erase(QRect(4, 4, 4, 4));
+    map.set_row(QPoint(0, 2), "cc", 2);
+    BOOST_CHECK_EQUAL( copy.size(), 64u );
+    BOOST_CHECK_EQUAL( copy.tile_count(), 4u );
+    BOOST_CHECK_EQUAL( copy.get(QPoint(1, 1)), 'a' );
+    BOOST_CHECK_EQUAL( copy.get(QPoint(5, 5)), 'a' );
+    BOOST_CHECK_EQUAL( copy.get(QPoint(0, 2)), 'a' );
+    BOOST_CHECK_EQUAL( map.size(), 48u );
+    BOOST_CHECK_EQUAL( map.tile_count(), 3u );
+    BOOST_CHECK_EQUAL( map.get(QPoint(1, 1)), 'b' );
+    BOOST_CHECK_EQUAL( map.get(QPoint(0, 2)), 'c' );
+
+    copy.fill(QRect(0, 0, 1, 1), 'z');
+    BOOST_CHECK_EQUAL( map.get(QPoint(0, 0)), 'a' );
+
+    std::string text;
+    for ( const auto& pair : copy )
+        text += pair.second;
+    BOOST_CHECK_EQUAL( text, "z" + std::string(63, 'a') );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_snapshot )
+{
+    Layer layer(3);
+    layer.set_row(0, 0, "hello");
+    Layer::Snapshot snapshot = layer.snapshot();
+
+    layer.set_char(QPoint(0, 0), 'j');
+    layer.set_color(4);
+    BOOST_CHECK_EQUAL( snapshot.color, 3u );
+    BOOST_CHECK_EQUAL( TextWriter(snapshot.characters).to_string(), "hello" );
+    BOOST_CHECK_EQUAL( layer.to_string(), "jello" );
+}
+
+BOOST_AUTO_TEST_CASE( test_tile_map_occupancy )
+{
+    // Tiles wider than a mask word
+    typedef TileMap<char, 7> Map;
+    Map map;
+    std::map<QPoint, char, Layer::QPointCmp> expected;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> coord(-200, 200);
+    std::uniform_int_distribution<int> length(1, 150);
+    std::uniform_int_distribution<int> op(0, 4);
+
+    auto check = [&map, &expected](const QRect& rect) {
+        std::vector<std::pair<QPoint, char>> visited;
+        map.for_each_in(rect, [&visited](QPoint pos, char ch) { visited.emplace_back(pos, ch); });
+        std::sort(visited.begin(), visited.end(), [](const auto& a, const auto& b) {
+            return Layer::QPointCmp()(a.first, b.first);
+        });
+        std::vector<std::pair<QPoint, char>> inside;
+        for ( const auto& pair : expected )
+            if ( rect.contains(pair.first) )
+                inside.emplace_back(pair.first, pair.second);
+        return visited == inside;
+    };
+
+    for ( int i = 0; i < 300; i++ )
+    {
+        QPoint pos(coord(random), coord(random));
+        QRect rect(pos, QSize(length(random), length(random) / 10 + 1));
+        char ch = 'a' + i % 26;
+        switch ( op(random) )
+        {
+            case 0:
+                map.set(pos, ch);
+                expected[pos] = ch;
+                break;
+            case 1:
+                map.erase(pos);
+                expected.erase(pos);
+                break;
+            case 2:
+                map.fill(rect, ch);
+                for ( int y = rect.top(); y <= rect.bottom(); y++ )
+                    for ( int x = rect.left(); x <= rect.right(); x++ )
+                        expected[QPoint(x, y)] = ch;
+                break;
+            case 3:
+                map.erase(rect);
+                for ( int y = rect.top(); y <= rect.bottom(); y++ )
+                    for ( int x = rect.left(); x <= rect.right(); x++ )
+                        expected.erase(QPoint(x, y));
+                break;
+            case 4:
+            {
+                std::string row(rect.width(), '\0');
+                for ( std::size_t j = 0; j < row.size(); j += 3 )
+                    row[j] = ch;
+                map.set_row(pos, row.data(), row.size());
+                for ( std::size_t j = 0; j < row.size(); j++ )
+                {
+                    if ( row[j] )
+                        expected[QPoint(pos.x() + j, pos.y())] = ch;
+                    else
+                        expected.erase(QPoint(pos.x() + j, pos.y()));
+                }
+                break;
+            }
+        }
+    }
+
+    Map copy;
+    copy.blit(map, QPoint(3, -5));
+
+    BOOST_CHECK_EQUAL( map.size(), expected.size() );
+    BOOST_CHECK( std::equal(map.begin(), map.end(), expected.begin(), expected.end(),
+        [](const Map::value_type& a, const std::pair<const QPoint, char>& b) {
+            return a.first == b.first && a.second == b.second;
+        }) );
+    BOOST_CHECK( check(QRect(-300, -300, 600, 600)) );
+    BOOST_CHECK( check(QRect(-100, 20, 250, 40)) );
+    BOOST_CHECK( check(QRect(63, -64, 66, 129)) );
+    BOOST_CHECK_EQUAL( copy.size(), expected.size() );
+    for ( const auto& pair : expected )
+        BOOST_CHECK_EQUAL( copy.get(pair.first + QPoint(3, -5)), pair.second );
+}
+
+BOOST_AUTO_TEST_CASE( test_layer_for_each_in )
+{
+    Layer layer(0);
+    layer.set_row(0, 0, "ab  cd");
+    layer.set_row(5, 100, "x");
+    std::string visited;
+    layer.for_each_in(QRect(1, 0, 4, 10), [&visited](QPoint, char ch) { visited += ch; });
+    BOOST_CHECK_EQUAL( visited, "bc" );
+}
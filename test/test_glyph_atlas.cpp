@@ -0,0 +1,144 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Glyph_Atlas
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "ascii/glyph_atlas.hpp"
+
+using namespace ascii;
+
+static GlyphAtlas::Glyph solid_glyph(char character, uint8_t value)
+{
+    GlyphAtlas::Glyph glyph;
+    glyph.character = character;
+    glyph.pixels.fill(value);
+    return glyph;
+}
+
+static std::vector<GlyphAtlas::Glyph> random_glyphs(std::mt19937& random, int count)
+{
+    // Few distinct values so there are plenty of equal sums and ties
+    std::uniform_int_distribution<int> value(0, 3);
+    std::vector<GlyphAtlas::Glyph> glyphs(count);
+    for ( int i = 0; i < count; i++ )
+    {
+        glyphs[i].character = ' ' + i;
+        for ( auto& pixel : glyphs[i].pixels )
+            pixel = value(random) * 85;
+    }
+    return glyphs;
+}
+
+BOOST_AUTO_TEST_CASE( test_downsample )
+{
+    GlyphAtlas::Block block;
+
+    std::vector<uint8_t> pixels(16 * 32, 0);
+    for ( int y = 0; y < 32; y++ )
+        for ( int x = 0; x < 16; x++ )
+            pixels[y * 16 + x] = (x % 2) * 100 + (y < 16 ? 0 : 50);
+    GlyphAtlas::downsample(pixels.data(), 16, 32, 16, block.data());
+    BOOST_CHECK_EQUAL( block[0], 50 );
+    BOOST_CHECK_EQUAL( block[7], 50 );
+    BOOST_CHECK_EQUAL( block[8 * 8], 100 );
+    BOOST_CHECK_EQUAL( block[15 * 8 + 7], 100 );
+
+    // Smaller areas repeat pixels, the stride skips the last column
+    pixels = {10, 20, 99, 30, 40, 99};
+    GlyphAtlas::downsample(pixels.data(), 2, 2, 3, block.data());
+    BOOST_CHECK_EQUAL( block[0], 10 );
+    BOOST_CHECK_EQUAL( block[7], 20 );
+    BOOST_CHECK_EQUAL( block[15 * 8], 30 );
+    BOOST_CHECK_EQUAL( block[15 * 8 + 7], 40 );
+}
+
+BOOST_AUTO_TEST_CASE( test_sad )
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> value(0, 255);
+    for ( int i = 0; i < 100; i++ )
+    {
+        GlyphAtlas::Block a, b;
+        unsigned expected = 0;
+        for ( int j = 0; j < GlyphAtlas::block_size; j++ )
+        {
+            a[j] = value(random);
+            b[j] = value(random);
+            expected += std::abs(a[j] - b[j]);
+        }
+        BOOST_CHECK_EQUAL( GlyphAtlas::sad(a.data(), b.data()), expected );
+    }
+
+    auto black = solid_glyph('#', 0);
+    auto white = solid_glyph(' ', 255);
+    BOOST_CHECK_EQUAL( GlyphAtlas::sad(black.pixels.data(), white.pixels.data()), 255u * 128 );
+}
+
+BOOST_AUTO_TEST_CASE( test_match )
+{
+    GlyphAtlas atlas({solid_glyph(' ', 255), solid_glyph('#', 0), solid_glyph('+', 128)});
+    BOOST_CHECK_EQUAL( atlas.size(), 3u );
+    BOOST_CHECK_EQUAL( atlas.character(0), '#' );
+    BOOST_CHECK_EQUAL( atlas.character(2), ' ' );
+
+    BOOST_CHECK_EQUAL( atlas.match(solid_glyph(0, 10).pixels.data()), '#' );
+    BOOST_CHECK_EQUAL( atlas.match(solid_glyph(0, 100).pixels.data()), '+' );
+    BOOST_CHECK_EQUAL( atlas.match(solid_glyph(0, 250).pixels.data()), ' ' );
+    // Tie, the glyph given first wins
+    BOOST_CHECK_EQUAL( atlas.match(solid_glyph(0, 64).pixels.data()), '#' );
+}
+
+BOOST_AUTO_TEST_CASE( test_match_brute_force )
+{
+    std::mt19937 random(2);
+    std::uniform_int_distribution<int> value(0, 255);
+    for ( int count : {1, 2, 10, 95} )
+    {
+        auto glyphs = random_glyphs(random, count);
+        GlyphAtlas atlas(glyphs);
+
+        for ( int i = 0; i < 200; i++ )
+        {
+            GlyphAtlas::Block block;
+            if ( i % 2 )
+                block = glyphs[i % count].pixels;
+            else
+                for ( auto& pixel : block )
+                    pixel = value(random) / 85 * 85;
+
+            std::size_t expected = 0;
+            unsigned expected_sad = GlyphAtlas::sad(block.data(), glyphs[0].pixels.data());
+            for ( int j = 1; j < count; j++ )
+            {
+                unsigned sad = GlyphAtlas::sad(block.data(), glyphs[j].pixels.data());
+                if ( sad < expected_sad )
+                {
+                    expected = j;
+                    expected_sad = sad;
+                }
+            }
+
+            BOOST_CHECK_EQUAL( atlas.match(block.data()), glyphs[expected].character );
+        }
+    }
+}
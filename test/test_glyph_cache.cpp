@@ -0,0 +1,121 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Glyph_Cache
+
+#include <boost/test/unit_test.hpp>
+
+#include "view/glyph_cache.hpp"
+
+using namespace view;
+
+/**
+ * \brief 2x3 glyphs, '#' is solid, '.' has ink on the top-left pixel only
+ */
+static GlyphCache test_cache()
+{
+    std::vector<uint8_t> coverage(GlyphCache::glyph_count * 6, 0);
+    std::fill_n(coverage.begin() + GlyphCache::index('#') * 6, 6, 255);
+    coverage[GlyphCache::index('.') * 6] = 255;
+    return GlyphCache(QSize(2, 3), coverage);
+}
+
+BOOST_AUTO_TEST_CASE( test_index )
+{
+    BOOST_CHECK_EQUAL( GlyphCache::index(' '), 0 );
+    BOOST_CHECK_EQUAL( GlyphCache::index('!'), 1 );
+    BOOST_CHECK_EQUAL( GlyphCache::index('~'), GlyphCache::glyph_count - 1 );
+    BOOST_CHECK_EQUAL( GlyphCache::index('\n'), 0 );
+    BOOST_CHECK_EQUAL( GlyphCache::index(0x7f), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_atlas )
+{
+    GlyphCache cache = test_cache();
+    const QImage& atlas = cache.atlas(qRgb(255, 0, 0), qRgb(0, 0, 255));
+    BOOST_CHECK_EQUAL( atlas.width(), 2 );
+    BOOST_CHECK_EQUAL( atlas.height(), 3 * GlyphCache::glyph_count );
+    BOOST_CHECK_EQUAL( atlas.pixel(1, 1), qRgb(0, 0, 255) );
+    int hash = GlyphCache::index('#') * 3;
+    BOOST_CHECK_EQUAL( atlas.pixel(0, hash), qRgb(255, 0, 0) );
+    BOOST_CHECK_EQUAL( atlas.pixel(1, hash + 2), qRgb(255, 0, 0) );
+
+    // Atlases are cached
+    BOOST_CHECK_EQUAL( &cache.atlas(qRgb(255, 0, 0), qRgb(0, 0, 255)), &atlas );
+    BOOST_CHECK_NE( &cache.atlas(qRgb(0, 255, 0), qRgb(0, 0, 255)), &atlas );
+}
+
+BOOST_AUTO_TEST_CASE( test_atlas_blend )
+{
+    std::vector<uint8_t> coverage(GlyphCache::glyph_count, 0);
+    coverage[GlyphCache::index('a')] = 51;
+    GlyphCache cache(QSize(1, 1), coverage);
+    const QImage& atlas = cache.atlas(qRgb(255, 0, 100), qRgb(0, 255, 0));
+    BOOST_CHECK_EQUAL( atlas.pixel(0, GlyphCache::index('a')), qRgb(51, 204, 20) );
+}
+
+BOOST_AUTO_TEST_CASE( test_draw )
+{
+    GlyphCache cache = test_cache();
+    const QImage& atlas = cache.atlas(qRgb(0, 0, 0), qRgb(255, 255, 255));
+    QImage target(5, 5, QImage::Format_ARGB32_Premultiplied);
+    target.fill(qRgb(0, 255, 0));
+
+    cache.draw(target, QPoint(1, 1), '.', atlas, target.rect());
+    BOOST_CHECK_EQUAL( target.pixel(1, 1), qRgb(0, 0, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(2, 1), qRgb(255, 255, 255) );
+    BOOST_CHECK_EQUAL( target.pixel(2, 3), qRgb(255, 255, 255) );
+    BOOST_CHECK_EQUAL( target.pixel(3, 1), qRgb(0, 255, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(1, 4), qRgb(0, 255, 0) );
+
+    // Clipped to the target and to the clip rectangle
+    cache.draw(target, QPoint(4, -1), '#', atlas, target.rect());
+    BOOST_CHECK_EQUAL( target.pixel(4, 0), qRgb(0, 0, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(4, 1), qRgb(0, 0, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(4, 2), qRgb(0, 255, 0) );
+
+    cache.draw(target, QPoint(0, 3), '#', atlas, QRect(1, 0, 4, 4));
+    BOOST_CHECK_EQUAL( target.pixel(0, 3), qRgb(0, 255, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(1, 3), qRgb(0, 0, 0) );
+    BOOST_CHECK_EQUAL( target.pixel(1, 4), qRgb(0, 255, 0) );
+}
+
+BOOST_AUTO_TEST_CASE( test_trim )
+{
+    GlyphCache cache = test_cache();
+    for ( int i = 0; i < 10; i++ )
+        cache.atlas(qRgb(i, 0, 0), qRgb(0, 0, 255));
+    BOOST_CHECK_EQUAL( cache.atlas_count(), 10u );
+
+    // Requesting an atlas makes it the most recently used
+    const QImage* first = &cache.atlas(qRgb(0, 0, 0), qRgb(0, 0, 255));
+    cache.trim(3);
+    BOOST_CHECK_EQUAL( cache.atlas_count(), 3u );
+    BOOST_CHECK_EQUAL( &cache.atlas(qRgb(0, 0, 0), qRgb(0, 0, 255)), first );
+    cache.atlas(qRgb(9, 0, 0), qRgb(0, 0, 255));
+    cache.atlas(qRgb(8, 0, 0), qRgb(0, 0, 255));
+    BOOST_CHECK_EQUAL( cache.atlas_count(), 3u );
+
+    cache.trim(0);
+    BOOST_CHECK_EQUAL( cache.atlas_count(), 0u );
+    for ( std::size_t i = 0; i < GlyphCache::max_atlases + 5; i++ )
+        cache.atlas(qRgb(0, i, 0), qRgb(0, 0, 255));
+    cache.trim();
+    BOOST_CHECK_EQUAL( cache.atlas_count(), GlyphCache::max_atlases );
+}
@@ -0,0 +1,255 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_History
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+#include "document/history.hpp"
+
+using namespace doc;
+
+BOOST_AUTO_TEST_CASE( test_undo_redo )
+{
+    Layer layer(0);
+    History history;
+    history.track(&layer);
+    BOOST_CHECK( !history.can_undo() );
+
+    layer.set_row(0, 0, "hello");
+    layer.set_char(QPoint(1, 0), 'a');
+    layer.remove_char(QPoint(4, 0));
+    BOOST_CHECK_EQUAL( history.undo_count(), 3u );
+    BOOST_CHECK_EQUAL( layer.to_string(), "hall" );
+
+    BOOST_CHECK( history.undo() );
+    BOOST_CHECK_EQUAL( layer.to_string(), "hallo" );
+    BOOST_CHECK( history.undo() );
+    BOOST_CHECK_EQUAL( layer.to_string(), "hello" );
+    BOOST_CHECK( history.undo() );
+    BOOST_CHECK( layer.characters().empty() );
+    BOOST_CHECK( !history.undo() );
+
+    BOOST_CHECK( history.redo() );
+    BOOST_CHECK( history.redo() );
+    BOOST_CHECK_EQUAL( layer.to_string(), "hallo" );
+    BOOST_CHECK_EQUAL( history.redo_count(), 1u );
+
+    // New edits drop the steps that have been undone
+    layer.set_char(QPoint(0, 0), 'c');
+    BOOST_CHECK( !history.can_redo() );
+    BOOST_CHECK_EQUAL( history.undo_count(), 3u );
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.to_string(), "hallo" );
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_step )
+{
+    Layer layer(0);
+    layer.fill_rect(QRect(0, 0, 100, 100), '.');
+    History history;
+    history.track(&layer);
+
+    {
+        Layer::EditBatch batch(layer);
+        layer.fill_rect(QRect(10, 10, 5, 5), '#');
+        layer.set_char(QPoint(12, 12), '@');
+        layer.clear_rect(QRect(90, 0, 10, 1));
+        // Doesn't change anything
+        layer.set_char(QPoint(50, 50), '.');
+    }
+    BOOST_REQUIRE_EQUAL( history.undo_count(), 1u );
+
+    // Only the changed cells are stored
+    const History::Step& step = history.undo_steps().back();
+    std::size_t cells = 0;
+    for ( const auto& row : step.rows )
+    {
+        BOOST_CHECK_EQUAL( row.before.size(), row.after.size() );
+        cells += row.before.size();
+    }
+    BOOST_CHECK_EQUAL( cells, 35u );
+
+    std::string edited = layer.to_string();
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.characters().size(), 10000u );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(12, 12)), '.' );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(95, 0)), '.' );
+    history.redo();
+    BOOST_CHECK_EQUAL( layer.to_string(), edited );
+}
+
+BOOST_AUTO_TEST_CASE( test_sparse_blit )
+{
+    Layer layer(0);
+    History history;
+    history.track(&layer);
+
+    Layer stamp(0);
+    stamp.set_char(QPoint(0, 0), 'a');
+    stamp.set_char(QPoint(100000, 100000), 'b');
+    layer.blit(stamp, QPoint(5, 5));
+    BOOST_CHECK_EQUAL( history.undo_steps().back().rows.size(), 2u );
+    BOOST_CHECK( history.memory_usage() < 1000 );
+
+    history.undo();
+    BOOST_CHECK( layer.characters().empty() );
+}
+
+BOOST_AUTO_TEST_CASE( test_sparse_clear )
+{
+    Layer layer(0);
+    layer.set_char(QPoint(10, 10), 'a');
+    layer.set_char(QPoint(-50000, 70000), 'b');
+    History history;
+    history.track(&layer);
+
+    // Capturing the whole area would take terabytes
+    layer.clear_rect(QRect(-1000000, -1000000, 2000000, 2000000));
+    BOOST_CHECK( layer.characters().empty() );
+    BOOST_REQUIRE_EQUAL( history.undo_count(), 1u );
+    BOOST_CHECK_EQUAL( history.undo_steps().back().rows.size(), 2u );
+    BOOST_CHECK( history.memory_usage() < 1000 );
+
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.characters().size(), 2u );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(10, 10)), 'a' );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(-50000, 70000)), 'b' );
+
+    // Changes no cell
+    history.redo();
+    layer.clear_rect(QRect(-1000000, -1000000, 2000000, 2000000));
+    layer.fill_rect(QRect(0, 0, 3, 3), '.');
+    layer.fill_rect(QRect(0, 0, 3, 3), '.');
+    BOOST_CHECK_EQUAL( history.undo_count(), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_empty_cell )
+{
+    Layer layer(0);
+    History history;
+    history.track(&layer);
+
+    {
+        Layer::EditBatch batch(layer);
+        layer.set_char(QPoint(3, 0), 'x');
+        layer.set_char(QPoint(3, 0), 'y');
+        layer.fill_rect(QRect(0, 0, 100, 100), 'z');
+    }
+    BOOST_REQUIRE_EQUAL( history.undo_count(), 1u );
+    history.undo();
+    BOOST_CHECK( layer.characters().empty() );
+}
+
+BOOST_AUTO_TEST_CASE( test_color )
+{
+    Layer layer(1);
+    History history;
+    history.track(&layer);
+
+    layer.set_color(2);
+    layer.set_char(QPoint(0, 0), 'x');
+    layer.set_color(3);
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.color(), 2u );
+    history.undo();
+    BOOST_CHECK( layer.characters().empty() );
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.color(), 1u );
+    history.redo();
+    history.redo();
+    history.redo();
+    BOOST_CHECK_EQUAL( layer.color(), 3u );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(0, 0)), 'x' );
+}
+
+BOOST_AUTO_TEST_CASE( test_merge )
+{
+    Layer layer(0);
+    History history;
+    history.track(&layer);
+
+    history.set_merge_id(1);
+    std::string text = "typing";
+    for ( std::size_t i = 0; i < text.size(); i++ )
+        layer.set_char(QPoint(i, 0), text[i]);
+    layer.remove_char(QPoint(5, 0));
+    BOOST_CHECK_EQUAL( history.undo_count(), 1u );
+
+    history.set_merge_id(2);
+    layer.set_char(QPoint(0, 1), 'x');
+    history.set_merge_id(-1);
+    layer.set_char(QPoint(1, 1), 'y');
+    layer.set_char(QPoint(2, 1), 'z');
+    BOOST_CHECK_EQUAL( history.undo_count(), 4u );
+
+    history.undo();
+    history.undo();
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.to_string(), "typin" );
+
+    // Steps after an undo start a new merge sequence
+    history.set_merge_id(1);
+    layer.set_char(QPoint(5, 0), 'g');
+    BOOST_CHECK_EQUAL( history.undo_count(), 2u );
+    history.undo();
+    history.undo();
+    BOOST_CHECK( layer.characters().empty() );
+}
+
+BOOST_AUTO_TEST_CASE( test_memory_limit )
+{
+    Layer layer(0);
+    History history;
+    history.track(&layer);
+
+    for ( int i = 0; i < 10; i++ )
+        layer.fill_rect(QRect(0, i, 100, 1), 'a' + i);
+    BOOST_CHECK_EQUAL( history.undo_count(), 10u );
+    std::size_t step_size = history.memory_usage() / 10;
+
+    history.set_memory_limit(step_size * 3);
+    BOOST_CHECK_EQUAL( history.undo_count(), 3u );
+    BOOST_CHECK( history.memory_usage() <= history.memory_limit() );
+
+    // The latest step is always kept
+    history.set_memory_limit(1);
+    BOOST_CHECK_EQUAL( history.undo_count(), 1u );
+    history.undo();
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(0, 9)), ' ' );
+    BOOST_CHECK_EQUAL( layer.char_at(QPoint(0, 8)), 'i' );
+}
+
+BOOST_AUTO_TEST_CASE( test_destroyed_layer )
+{
+    std::unique_ptr<Layer> first(new Layer(0));
+    Layer second(0);
+    History history;
+    history.track(first.get());
+    history.track(&second);
+
+    first->set_char(QPoint(0, 0), 'a');
+    second.set_char(QPoint(0, 0), 'b');
+    first.reset();
+    BOOST_CHECK_EQUAL( history.undo_count(), 1u );
+    history.undo();
+    BOOST_CHECK( second.characters().empty() );
+}
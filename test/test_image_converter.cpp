@@ -0,0 +1,145 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Image_Converter
+
+#include <boost/test/unit_test.hpp>
+
+#include "ascii/image_converter.hpp"
+
+using namespace ascii;
+
+BOOST_AUTO_TEST_CASE( test_grid_size )
+{
+    ImageConverter converter(QSize(4, 8));
+    BOOST_CHECK( converter.grid_size(QImage()) == QSize(0, 0) );
+    BOOST_CHECK( converter.grid_size(QImage(8, 16, QImage::Format_RGB32)) == QSize(2, 2) );
+    BOOST_CHECK( converter.grid_size(QImage(9, 17, QImage::Format_RGB32)) == QSize(3, 3) );
+}
+
+BOOST_AUTO_TEST_CASE( test_match )
+{
+    ImageConverter converter;
+    converter.set_ramp(" .#");
+    converter.set_coverage_weight(0);
+    CellFeatures features;
+    features.luminance = 1;
+    BOOST_CHECK_EQUAL( converter.match(features), ' ' );
+    features.luminance = 0.5;
+    BOOST_CHECK_EQUAL( converter.match(features), '.' );
+    features.luminance = 0;
+    BOOST_CHECK_EQUAL( converter.match(features), '#' );
+
+    converter.set_inverted(true);
+    BOOST_CHECK_EQUAL( converter.match(features), ' ' );
+}
+
+BOOST_AUTO_TEST_CASE( test_match_coverage )
+{
+    ImageConverter converter;
+    converter.set_ramp(" .:#");
+
+    // Same mean, but flat light gray has no ink pixels
+    CellFeatures gray;
+    gray.luminance = 0.55;
+    gray.coverage = 0;
+    CellFeatures inked;
+    inked.luminance = 0.55;
+    inked.coverage = 0.6;
+
+    converter.set_coverage_weight(0);
+    BOOST_CHECK_EQUAL( converter.match(gray), converter.match(inked) );
+
+    converter.set_coverage_weight(0.5);
+    BOOST_CHECK_EQUAL( converter.match(gray), ' ' );
+    BOOST_CHECK_EQUAL( converter.match(inked), ':' );
+
+    converter.set_coverage_weight(1);
+    inked.luminance = 0.9;
+    BOOST_CHECK_EQUAL( converter.match(inked), ':' );
+}
+
+BOOST_AUTO_TEST_CASE( test_convert )
+{
+    ThreadPool pool(3);
+    ImageConverter converter(QSize(2, 2), pool);
+    converter.set_ramp(" #");
+
+    // Checkerboard of black and white cells, larger than a tile
+    int cells = ImageConverter::tile_cells + 3;
+    QImage image(cells * 2, cells * 2 - 1, QImage::Format_Grayscale8);
+    for ( int y = 0; y < image.height(); y++ )
+        for ( int x = 0; x < image.width(); x++ )
+            image.scanLine(y)[x] = (x / 2 + y / 2) % 2 ? 255 : 0;
+
+    auto output = converter.convert(image);
+    BOOST_REQUIRE_EQUAL( output.size(), std::size_t(cells * cells) );
+    for ( int y = 0; y < cells; y++ )
+        for ( int x = 0; x < cells; x++ )
+            BOOST_CHECK_EQUAL( output[y * cells + x], (x + y) % 2 ? ' ' : '#' );
+
+    doc::Layer layer(0);
+    converter.convert(image.convertToFormat(QImage::Format_RGB888), layer, QPoint(1, 0));
+    BOOST_CHECK_EQUAL( layer.char_at({1, 0}), '#' );
+    BOOST_CHECK_EQUAL( layer.char_at({2, 0}), ' ' );
+    BOOST_CHECK_EQUAL( layer.characters().size(), std::size_t(cells * cells + 1) / 2 );
+}
+
+BOOST_AUTO_TEST_CASE( test_features )
+{
+    ImageConverter converter(QSize(2, 1));
+    QImage image(2, 1, QImage::Format_ARGB32);
+    image.setPixel(0, 0, qRgba(0, 0, 0, 255));
+    image.setPixel(1, 0, qRgba(0, 0, 0, 0));
+    converter.set_ramp("0123456789");
+    // Transparent pixels count as white
+    BOOST_CHECK_EQUAL( converter.convert(image)[0], '5' );
+}
+
+BOOST_AUTO_TEST_CASE( test_atlas )
+{
+    // Glyphs with ink in the top or bottom half
+    GlyphAtlas::Glyph top, bottom, blank;
+    top.character = '^';
+    bottom.character = '_';
+    blank.character = ' ';
+    blank.pixels.fill(255);
+    for ( int i = 0; i < GlyphAtlas::block_size; i++ )
+    {
+        top.pixels[i] = i < GlyphAtlas::block_size / 2 ? 0 : 255;
+        bottom.pixels[i] = 255 - top.pixels[i];
+    }
+    GlyphAtlas atlas({blank, top, bottom});
+
+    ImageConverter converter(QSize(3, 4));
+    converter.set_atlas(&atlas);
+
+    QImage image(9, 4, QImage::Format_Grayscale8);
+    for ( int y = 0; y < 4; y++ )
+        for ( int x = 0; x < 9; x++ )
+            image.scanLine(y)[x] = x < 3 ? 255 : (y < 2) == (x < 6) ? 0 : 255;
+
+    auto output = converter.convert(image);
+    BOOST_CHECK_EQUAL( std::string(output.begin(), output.end()), " ^_" );
+
+    // White becomes ink, which is as far from '^' as from '_'
+    converter.set_inverted(true);
+    output = converter.convert(image);
+    BOOST_CHECK_EQUAL( std::string(output.begin(), output.end()), "^_^" );
+}
@@ -0,0 +1,91 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Packed_Color
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "color/packed_color.hpp"
+
+using namespace color;
+
+static_assert(Color(PackedColor(1, 2, 3, 4)) == Color(1, 2, 3, 4), "Conversions must be constexpr");
+static_assert(!Color(PackedColor()).valid(), "Conversions must be constexpr");
+
+BOOST_AUTO_TEST_CASE( test_layout )
+{
+    PackedColor color(0x12, 0x34, 0x56, 0x78);
+    BOOST_CHECK_EQUAL( color.argb(), 0x78123456u );
+    BOOST_CHECK_EQUAL( color.red(), 0x12 );
+    BOOST_CHECK_EQUAL( color.green(), 0x34 );
+    BOOST_CHECK_EQUAL( color.blue(), 0x56 );
+    BOOST_CHECK_EQUAL( color.alpha(), 0x78 );
+
+    PackedColor colors[3] = {color, PackedColor(), PackedColor(1, 2, 3)};
+    uint32_t values[3];
+    std::memcpy(values, colors, sizeof(colors));
+    BOOST_CHECK_EQUAL( values[0], 0x78123456u );
+    BOOST_CHECK_EQUAL( values[1], invalid_argb );
+    BOOST_CHECK_EQUAL( values[2], 0xff010203u );
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid )
+{
+    BOOST_CHECK( !PackedColor().valid() );
+    BOOST_CHECK( PackedColor(0, 0, 0, 0).valid() );
+    BOOST_CHECK( Color().to<PackedColor>() == PackedColor() );
+    BOOST_CHECK( !Color(PackedColor()).valid() );
+    BOOST_CHECK_EQUAL( Color(PackedColor()), Color() );
+
+    // Valid colors never pack to the reserved value
+    PackedColor reserved(0xff, 0x00, 0xff, 0x00);
+    BOOST_CHECK( reserved.valid() );
+    BOOST_CHECK_EQUAL( reserved.argb(), 0x00ff00feu );
+    BOOST_CHECK( PackedColor::from_argb(invalid_argb).valid() );
+    BOOST_CHECK( Color(0xff, 0, 0xff, 0).to<PackedColor>().valid() );
+}
+
+BOOST_AUTO_TEST_CASE( test_round_trip )
+{
+    for ( int rgb = 0; rgb < (1 << 24); rgb += 4099 )
+        for ( int alpha : {0, 1, 128, 255} )
+        {
+            Color color(rgb >> 16, (rgb >> 8) & 0xff, rgb & 0xff, alpha);
+            PackedColor packed = color.to<PackedColor>();
+            BOOST_CHECK_EQUAL( packed.argb(), (uint32_t(alpha) << 24) | rgb );
+            BOOST_CHECK_EQUAL( Color(packed), color );
+        }
+}
+
+BOOST_AUTO_TEST_CASE( test_pack_arrays )
+{
+    std::vector<Color> colors{Color(1, 2, 3), Color(), Color(4, 5, 6, 7)};
+    std::vector<PackedColor> packed(colors.size());
+    pack(colors.data(), colors.data() + colors.size(), packed.data());
+    BOOST_CHECK( packed[0] == PackedColor(1, 2, 3) );
+    BOOST_CHECK( !packed[1].valid() );
+    BOOST_CHECK( packed[2] == PackedColor(4, 5, 6, 7) );
+
+    std::vector<Color> unpacked(packed.size());
+    unpack(packed.data(), packed.data() + packed.size(), unpacked.data());
+    BOOST_CHECK( unpacked == colors );
+}
@@ -0,0 +1,140 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Palette
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "color/palette.hpp"
+
+using namespace color;
+
+std::size_t brute_force_nearest(const Palette& palette, const Color& color)
+{
+    std::size_t best = Palette::npos;
+    float best_distance = 0;
+    repr::Lab lab = color.to<repr::Lab>();
+    for ( std::size_t i = 0; i < palette.size(); i++ )
+    {
+        float distance = delta_e_squared(lab, palette.lab(i), palette.metric());
+        if ( best == Palette::npos || distance < best_distance )
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+std::vector<Color> random_colors(std::mt19937& random, std::size_t count)
+{
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<Color> colors;
+    for ( std::size_t i = 0; i < count; i++ )
+        colors.emplace_back(channel(random), channel(random), channel(random));
+    return colors;
+}
+
+BOOST_AUTO_TEST_CASE( test_empty )
+{
+    Palette palette;
+    BOOST_CHECK( palette.empty() );
+    BOOST_CHECK_EQUAL( palette.nearest(Color(1, 2, 3)), Palette::npos );
+    BOOST_CHECK_EQUAL( palette.nearest_color(Color(1, 2, 3)), Color() );
+}
+
+BOOST_AUTO_TEST_CASE( test_exact )
+{
+    Palette palette({Color(0, 0, 0), Color(255, 0, 0), Color(255, 255, 255)});
+    BOOST_CHECK_EQUAL( palette.size(), 3u );
+    BOOST_CHECK_EQUAL( palette.nearest(Color(255, 0, 0)), 1u );
+    BOOST_CHECK_EQUAL( palette.nearest(Color(10, 10, 10)), 0u );
+    BOOST_CHECK_EQUAL( palette.nearest(Color(250, 240, 245)), 2u );
+    BOOST_CHECK_EQUAL( palette.nearest_color(Color(200, 20, 20)), Color(255, 0, 0) );
+    BOOST_CHECK_EQUAL( palette.nearest(palette.lab(1)), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( test_matches_brute_force )
+{
+    std::mt19937 random(42);
+    for ( std::size_t size : {1, 2, 16, 256} )
+    {
+        Palette palette(random_colors(random, size));
+        auto queries = random_colors(random, 500);
+        std::vector<std::size_t> batch(queries.size());
+        palette.nearest(queries.data(), queries.data() + queries.size(), batch.data());
+        for ( std::size_t i = 0; i < queries.size(); i++ )
+        {
+            std::size_t expected = brute_force_nearest(palette, queries[i]);
+            BOOST_CHECK_EQUAL( palette.nearest(queries[i].to<repr::Lab>()), expected );
+            // Twice to hit the cache
+            BOOST_CHECK_EQUAL( palette.nearest(queries[i]), expected );
+            BOOST_CHECK_EQUAL( palette.nearest(queries[i]), expected );
+            BOOST_CHECK_EQUAL( batch[i], expected );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_metrics_match_brute_force )
+{
+    std::mt19937 random(7);
+    for ( DeltaE metric : {DeltaE::CIE94, DeltaE::CIEDE2000} )
+    {
+        for ( std::size_t size : {1, 16, 256} )
+        {
+            Palette palette(random_colors(random, size), metric);
+            BOOST_CHECK( palette.metric() == metric );
+            for ( const Color& query : random_colors(random, 500) )
+            {
+                std::size_t expected = brute_force_nearest(palette, query);
+                BOOST_CHECK_EQUAL( palette.nearest(query.to<repr::Lab>()), expected );
+                BOOST_CHECK_EQUAL( palette.nearest(query), expected );
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_metric_changes_match )
+{
+    // Slightly closer in Lab to the gray, CIEDE2000 prefers the red
+    Palette cie76({Color(128, 128, 128), Color(200, 60, 60)});
+    Palette ciede2000(cie76.colors(), DeltaE::CIEDE2000);
+    Color query(100, 40, 45);
+    BOOST_CHECK_EQUAL( cie76.nearest(query), 0u );
+    BOOST_CHECK_EQUAL( ciede2000.nearest(query), 1u );
+    BOOST_CHECK_EQUAL( xterm256_nearest(query, DeltaE::CIEDE2000),
+                       16 + Palette(xterm256_palette(), 16, DeltaE::CIEDE2000).nearest(query) );
+
+    Palette copy = ciede2000;
+    BOOST_CHECK( copy.metric() == DeltaE::CIEDE2000 );
+    BOOST_CHECK_EQUAL( copy.nearest(query), ciede2000.nearest(query) );
+}
+
+BOOST_AUTO_TEST_CASE( test_copy )
+{
+    Palette palette({Color(0, 0, 0), Color(255, 255, 255)});
+    BOOST_CHECK_EQUAL( palette.nearest(Color(200, 200, 200)), 1u );
+    Palette copy = palette;
+    BOOST_CHECK_EQUAL( copy.nearest(Color(200, 200, 200)), 1u );
+    copy = Palette({Color(200, 200, 200), Color(255, 255, 255)});
+    BOOST_CHECK_EQUAL( copy.nearest(Color(200, 200, 200)), 0u );
+    BOOST_CHECK_EQUAL( palette.nearest(Color(200, 200, 200)), 1u );
+}
@@ -0,0 +1,61 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_RGB_Int3_Table
+
+#include <boost/test/unit_test.hpp>
+
+#include "color/rgb_int3_table.hpp"
+
+using namespace color;
+
+static_assert(rgb_int3_lookup(Color(255, 0, 0)).rgb == 0b001, "Table must be constexpr");
+
+BOOST_AUTO_TEST_CASE( test_lookup_12bit )
+{
+    for ( int i = 0; i < (1 << 12); i++ )
+    {
+        repr::RGB_int12 rgb12(i);
+        auto expected = Color(rgb12).to<repr::RGB_int3>();
+        auto converted = rgb_int3_lookup(Color(rgb12));
+        BOOST_CHECK_EQUAL( converted.rgb, expected.rgb );
+        BOOST_CHECK_EQUAL( converted.bright, expected.bright );
+    }
+
+    for ( int j = 0; j < 2; j++ )
+        for ( int i = 0; i < 8; i++ )
+        {
+            repr::RGB_int3 rgb3(i, j);
+            auto converted = rgb_int3_lookup(Color(rgb3));
+            BOOST_CHECK_EQUAL( converted.rgb, rgb3.rgb );
+            BOOST_CHECK_EQUAL( converted.bright, rgb3.bright );
+        }
+}
+
+BOOST_AUTO_TEST_CASE( test_lookup_exact )
+{
+    for ( int rgb = 0; rgb < (1 << 24); rgb += 997 )
+    {
+        Color color{repr::RGB_int24(rgb)};
+        auto expected = color.to<repr::RGB_int3>();
+        auto converted = rgb_int3_lookup_exact(color);
+        BOOST_CHECK_EQUAL( converted.rgb, expected.rgb );
+        BOOST_CHECK_EQUAL( converted.bright, expected.bright );
+    }
+}
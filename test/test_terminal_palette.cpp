@@ -0,0 +1,94 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Terminal_Palette
+
+#include <boost/test/unit_test.hpp>
+
+#include "color/terminal_palette.hpp"
+#include "color/palette.hpp"
+
+using namespace color;
+
+static_assert(xterm256_palette().colors[196] == Color(255, 0, 0), "Table must be constexpr");
+static_assert(terminal16_palette().lab[15].l > 99, "Table must be constexpr");
+
+BOOST_AUTO_TEST_CASE( test_terminal16 )
+{
+    for ( int i = 0; i < 16; i++ )
+    {
+        BOOST_CHECK_EQUAL( terminal16_color(i), Color(repr::RGB_int3(i & 7, i & 8)) );
+        BOOST_CHECK_EQUAL( xterm256_color(i), terminal16_color(i) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_xterm256 )
+{
+    BOOST_CHECK_EQUAL( xterm256_color(16), Color(0, 0, 0) );
+    BOOST_CHECK_EQUAL( xterm256_color(21), Color(0, 0, 255) );
+    BOOST_CHECK_EQUAL( xterm256_color(46), Color(0, 255, 0) );
+    BOOST_CHECK_EQUAL( xterm256_color(67), Color(95, 135, 175) );
+    BOOST_CHECK_EQUAL( xterm256_color(231), Color(255, 255, 255) );
+    BOOST_CHECK_EQUAL( xterm256_color(232), Color(8, 8, 8) );
+    BOOST_CHECK_EQUAL( xterm256_color(255), Color(238, 238, 238) );
+}
+
+template<std::size_t Size>
+    static void check_table(const PaletteTable<Size>& table, Color (*color)(int))
+{
+    BOOST_CHECK_EQUAL( PaletteTable<Size>::size, Size );
+    for ( std::size_t i = 0; i < Size; i++ )
+    {
+        // Computed at run time here
+        Color expected = color(i);
+        BOOST_CHECK_EQUAL( table.colors[i], expected );
+
+        auto lab = expected.to<repr::Lab>();
+        BOOST_CHECK_EQUAL( table.lab[i].l, lab.l );
+        BOOST_CHECK_EQUAL( table.lab[i].a, lab.a );
+        BOOST_CHECK_EQUAL( table.lab[i].b, lab.b );
+
+        auto hsv = expected.to<repr::HSVf>();
+        BOOST_CHECK_EQUAL( table.hsv[i].h, hsv.h );
+        BOOST_CHECK_EQUAL( table.hsv[i].s, hsv.s );
+        BOOST_CHECK_EQUAL( table.hsv[i].v, hsv.v );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_tables )
+{
+    check_table(terminal16_palette(), terminal16_color);
+    check_table(xterm256_palette(), xterm256_color);
+}
+
+BOOST_AUTO_TEST_CASE( test_palette_from_table )
+{
+    Palette from_table(xterm256_palette());
+    std::vector<Color> colors;
+    for ( int i = 0; i < 256; i++ )
+        colors.push_back(xterm256_color(i));
+    Palette from_colors(colors);
+
+    BOOST_CHECK( from_table.colors() == from_colors.colors() );
+    for ( int rgb = 0; rgb < (1 << 24); rgb += 9973 )
+    {
+        Color color{repr::RGB_int24(rgb)};
+        BOOST_CHECK_EQUAL( from_table.nearest(color), from_colors.nearest(color) );
+    }
+}
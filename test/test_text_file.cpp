@@ -0,0 +1,103 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Text_File
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "document/text_file.hpp"
+
+using namespace doc;
+
+BOOST_AUTO_TEST_CASE( test_reader_memory )
+{
+    std::string text = "Hello\r\n\n  world\nend\n";
+    TextFileReader reader(text.data(), text.size());
+    BOOST_CHECK( reader.is_open() );
+    BOOST_CHECK_EQUAL( reader.row_count(), 4 );
+
+    Layer layer(0);
+    reader.load(layer);
+    BOOST_CHECK_EQUAL( layer.to_string(), "Hello\n\n  world\nend" );
+    BOOST_CHECK( reader.is_loaded(3) );
+
+    TextFileReader empty(text.data(), 0);
+    BOOST_CHECK_EQUAL( empty.row_count(), 0 );
+
+    TextFileReader no_newline(text.data(), 3);
+    BOOST_CHECK_EQUAL( no_newline.row_count(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( test_reader_lazy )
+{
+    std::string text = "a\nb\nc\nd\ne";
+    TextFileReader reader(text.data(), text.size());
+    BOOST_CHECK_EQUAL( reader.row_count(), 5 );
+
+    Layer layer(0);
+    BOOST_CHECK_EQUAL( reader.load_rows(layer, 1, 3), 2 );
+    BOOST_CHECK_EQUAL( layer.to_string(), "\nb\nc" );
+    BOOST_CHECK( !reader.is_loaded(0) );
+    BOOST_CHECK( reader.is_loaded(2) );
+
+    // Rows edited after loading are not overwritten
+    layer.set_char(QPoint(0, 1), 'x');
+    BOOST_CHECK_EQUAL( reader.load_rows(layer, -10, 10), 3 );
+    BOOST_CHECK_EQUAL( layer.to_string(), "a\nx\nc\nd\ne" );
+    BOOST_CHECK_EQUAL( reader.load_rows(layer, 0, 5), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_file_round_trip )
+{
+    const char* file_name = "test_text_file.txt";
+
+    Layer layer(0);
+    std::string long_line(100000, '#');
+    layer.set_row(QPoint(0, 0), long_line.data(), long_line.size());
+    for ( int y = 1; y < 2000; y++ )
+        layer.set_char(QPoint(y % 80, y), 'a' + y % 26);
+    layer.set_char(QPoint(3, 4000), '!');
+    BOOST_REQUIRE( write_text_file(layer, file_name) );
+
+    {
+        std::ifstream file(file_name);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        BOOST_CHECK( contents.str() == layer.to_string() );
+    }
+
+    {
+        TextFileReader reader(file_name);
+        BOOST_REQUIRE( reader.is_open() );
+        BOOST_CHECK_EQUAL( reader.row_count(), 4001 );
+        Layer loaded(0);
+        reader.load(loaded);
+        BOOST_CHECK( loaded.to_string() == layer.to_string() );
+    }
+
+    std::remove(file_name);
+
+    TextFileReader missing(file_name);
+    BOOST_CHECK( !missing.is_open() );
+}
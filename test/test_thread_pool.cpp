@@ -0,0 +1,97 @@
+/**
+ * \file
+ * \author Mattia Basaglia
+ * \copyright Copyright 2015-2016 Mattia Basaglia
+ * \section License
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE Test_Thread_Pool
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include "ascii/thread_pool.hpp"
+
+using namespace ascii;
+
+BOOST_AUTO_TEST_CASE( test_parallel_for )
+{
+    ThreadPool pool(4);
+    BOOST_CHECK_EQUAL( pool.size(), 4u );
+
+    std::vector<int> output(1000, 0);
+    pool.parallel_for(output.size(), [&output](std::size_t i) {
+        output[i] = i * 2;
+    });
+    for ( std::size_t i = 0; i < output.size(); i++ )
+        BOOST_CHECK_EQUAL( output[i], int(i * 2) );
+
+    pool.parallel_for(0, [](std::size_t) {
+        throw std::runtime_error("Should not be called");
+    });
+}
+
+BOOST_AUTO_TEST_CASE( test_nested )
+{
+    ThreadPool pool(2);
+    std::atomic<int> total{0};
+    pool.parallel_for(8, [&pool, &total](std::size_t) {
+        pool.parallel_for(8, [&total](std::size_t) {
+            ++total;
+        });
+    });
+    BOOST_CHECK_EQUAL( total.load(), 64 );
+}
+
+BOOST_AUTO_TEST_CASE( test_exception )
+{
+    ThreadPool pool(3);
+    std::atomic<int> calls{0};
+    BOOST_CHECK_THROW(
+        pool.parallel_for(100, [&calls](std::size_t i) {
+            ++calls;
+            if ( i == 50 )
+                throw std::runtime_error("failure");
+        }),
+        std::runtime_error
+    );
+    BOOST_CHECK_EQUAL( calls.load(), 100 );
+}
+
+BOOST_AUTO_TEST_CASE( test_submit )
+{
+    std::atomic<int> total{0};
+    {
+        ThreadPool pool(2);
+        for ( int i = 0; i < 100; i++ )
+            pool.submit([&total]{ ++total; });
+    }
+    // The destructor waits for queued tasks
+    BOOST_CHECK_EQUAL( total.load(), 100 );
+}
+
+BOOST_AUTO_TEST_CASE( test_submit_exception )
+{
+    ThreadPool pool(2);
+    auto failed = pool.submit([]{ throw std::runtime_error("failure"); });
+    BOOST_CHECK_THROW( failed.get(), std::runtime_error );
+
+    // The worker is still running
+    int value = 0;
+    pool.submit([&value]{ value = 1; }).wait();
+    BOOST_CHECK_EQUAL( value, 1 );
+}